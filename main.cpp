@@ -1,34 +1,47 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
 #include <string>
+#include "src/doodle_engine.h"
 
 using namespace cv;
 using namespace std;
 
 // Global variables
-Mat frame, doodleLayer;
-bool drawing = false;
-Point lastPoint;
+Mat frame, output;
+doodle::DoodleEngine engine;
 Scalar drawColor = Scalar(0, 0, 255);
 int brushSize = 3;
 bool showHelp = true;
 
+// Draw with the brush tool through the engine
+void applyStrokeOp(collab::StrokeOpType type, int x, int y) {
+    collab::StrokeOp op;
+    op.type = type;
+    op.x = x;
+    op.y = y;
+    if (type == collab::StrokeOpType::Begin) {
+        op.size = static_cast<uint8_t>(brushSize);
+        for (int c = 0; c < 3; c++) {
+            op.color[c] = saturate_cast<uchar>(drawColor[c]);
+        }
+    }
+    engine.apply(op);
+}
+
 // Mouse callback function
 void mouseCallback(int event, int x, int y, int flags, void* userdata) {
     
     if (event == EVENT_LBUTTONDOWN) {
-        drawing = true;
-        lastPoint = Point(x, y);
+        applyStrokeOp(collab::StrokeOpType::Begin, x, y);
         cout << "Drawing started at: (" << x << ", " << y << ")" << endl;
     }
     
-    else if (event == EVENT_MOUSEMOVE && drawing) {
-        line(doodleLayer, lastPoint, Point(x, y), drawColor, brushSize);
-        lastPoint = Point(x, y);
+    else if (event == EVENT_MOUSEMOVE && engine.drawing()) {
+        applyStrokeOp(collab::StrokeOpType::Move, x, y);
     }
     
-    else if (event == EVENT_LBUTTONUP) {
-        drawing = false;
+    else if (event == EVENT_LBUTTONUP && engine.drawing()) {
+        applyStrokeOp(collab::StrokeOpType::End, x, y);
         cout << "Drawing stopped" << endl;
     }
     
@@ -120,12 +133,11 @@ int main() {
             break;
         }
         
-        if (doodleLayer.empty()) {
-            doodleLayer = Mat::zeros(frame.size(), CV_8UC3);
+        if (engine.empty()) {
+            engine.reset(frame.size(), CV_8UC3);
         }
         
-        Mat output;
-        addWeighted(frame, 1.0, doodleLayer, 1.0, 0, output);
+        engine.composite(frame, output);
         
         if (showHelp) {
             drawHelpText(output);
@@ -136,7 +148,7 @@ int main() {
         int key = waitKey(1) & 0xFF;
         
         if (key == 'c' || key == 'C') {
-            doodleLayer = Mat::zeros(frame.size(), CV_8UC3);
+            applyStrokeOp(collab::StrokeOpType::Clear, 0, 0);
             cout << "Drawing cleared" << endl;
         }
         else if (key == 'r' || key == 'R') {
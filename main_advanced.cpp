@@ -2,37 +2,85 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#include <stack>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
 #include <ctime>
 #include <random>
+#include "src/allocation_counter.h"
+#include "src/chroma_key.h"
+#include "src/configuration.h"
+#include "src/doodle_engine.h"
+#include "src/frame_pacer.h"
+#include "src/frame_pool.h"
+#include "src/glyph_atlas.h"
+#include "src/input_recorder.h"
+#include "src/latency_tracker.h"
+#include "src/memory_accounting.h"
+#include "src/mjpeg_server.h"
+#include "src/motion_tracker.h"
+#include "src/performance_monitor.h"
+#include "src/project_file.h"
+#include "src/shared_frame_ring.h"
+#include "src/stroke_sync.h"
+#include "src/text_labels.h"
+
+// Debug builds can count every heap allocation, not just Mat buffers
+#ifdef LIVEDOODLE_COUNT_ALLOCATIONS
+#include "src/allocation_hooks.h"
+#endif
 
 using namespace cv;
 using namespace std;
 
-// Enums for tools
-enum DrawTool {
-    BRUSH,
-    ERASER,
-    LINE,
-    RECTANGLE,
-    CIRCLE,
-    ELLIPSE,
-    SPRAY,
-    FILL
-};
-
 // Global variables
-Mat frame, doodleLayer, tempLayer;
-stack<Mat> undoStack, redoStack;
-bool drawing = false;
-Point lastPoint, startPoint;
+Configuration config;
+Mat frame, output, preview;
 Scalar drawColor = Scalar(0, 0, 255);
 Scalar backgroundColor = Scalar(0, 0, 0);
 int brushSize = 3;
 bool showHelp = true;
 bool showColorPalette = true;
-DrawTool currentTool = BRUSH;
-string toolNames[] = {"Brush", "Eraser", "Line", "Rectangle", "Circle", "Ellipse", "Spray", "Fill"};
+bool showStats = true;
+
+// Canvas, tools, history and compositing
+doodle::DoodleEngine engine;
+int currentTool = 0;
+
+// Scene anchoring: the canvas lives in the coordinates of the frame it was
+// started on and is warped by the camera motion accumulated since then
+doodle::MotionTracker motionTracker;
+bool stabilize = false;
+Matx33d anchorTransform = Matx33d::eye();
+Matx33d anchorInverse = Matx33d::eye();
+
+// Native project file, decoded tile by tile as the canvas is needed
+doodle::ProjectFile project;
+string projectPath = "session.ldp";
+vector<Rect> decodedTiles;
+
+// CV_8UC3, or CV_8UC1 for a palette-indexed canvas
+int canvasType = CV_8UC3;
+
+// Text labels and the glyph cache shared with the HUD
+doodle::GlyphAtlas glyphAtlas;
+doodle::TextLabels textLabels(glyphAtlas);
+
+// Composites go into pooled buffers; the loop is checked for allocations
+performance::FramePool outputPool;
+performance::FrameAllocationMonitor allocationMonitor;
+
+// Composited frames for other local processes
+doodle::SharedFrameRing frameRing;
+string shmOutput;
+doodle::MjpegServer mjpegServer;
+int mjpegPort = -1;
+
+// Background keying between capture and compositing
+doodle::ChromaKey chromaKey;
+Mat keyedFrame, transparentOutput;
 
 // Color palette
 vector<Scalar> colorPalette = {
@@ -48,38 +96,131 @@ vector<Scalar> colorPalette = {
     Scalar(203, 192, 255)   // Pink
 };
 
-// Random number generator for spray
+// Random number generator for stroke seeds
 default_random_engine generator;
-uniform_int_distribution<int> distribution(-10, 10);
 
-// Function to save current state for undo
-void saveState() {
-    undoStack.push(doodleLayer.clone());
-    // Clear redo stack when new action is performed
-    while (!redoStack.empty()) {
-        redoStack.pop();
+// Frame pacing and adaptive quality
+performance::FramePacer framePacer;
+performance::FPSCounter fpsCounter;
+bool hudVisible = true;
+double previewScale = 1.0;
+
+// Latency measurement and input recording/replay
+performance::LatencyTracker latencyTracker;
+InputRecorder inputRecorder;
+InputReplayer inputReplayer;
+uint64_t frameIndex = 0;
+
+// Collaborative drawing session
+collab::StrokeSyncPeer syncPeer;
+bool syncEnabled = false;
+vector<collab::StrokeBatch> syncedBatches;
+// Inputs whose operations wait for the session to order them
+vector<performance::LatencyTracker::Clock::time_point> syncedInputs;
+// Whether a local stroke is open; in a session the engine only sees it once ordered
+bool strokeOpen = false;
+
+Rect applyStrokeOp(collab::StrokeOpType type, int x, int y);
+void applySyncedStrokes();
+
+// Decode the tiles of an opened project that cover a canvas region
+void loadProjectTiles(const Rect& region) {
+    if (!project.isOpen() || project.fullyLoaded()) {
+        return;
     }
-    // Limit undo stack to 20 states to save memory
-    if (undoStack.size() > 20) {
-        stack<Mat> tempStack;
-        while (undoStack.size() > 1) {
-            tempStack.push(undoStack.top());
-            undoStack.pop();
-        }
-        undoStack.pop();
-        while (!tempStack.empty()) {
-            undoStack.push(tempStack.top());
-            tempStack.pop();
-        }
+    performance::ScopedMemoryTag tag(performance::MemoryTag::Canvas);
+    project.loadTiles(engine.canvas(), region, decodedTiles);
+    for (const Rect& tile : decodedTiles) {
+        engine.history().absorb(engine.canvas(), tile);
+        engine.compositor().addDamage(tile);
+    }
+}
+
+// Decode whatever is left of an opened project before the canvas is edited
+void ensureCanvasLoaded() {
+    loadProjectTiles(Rect(0, 0, engine.canvas().cols, engine.canvas().rows));
+}
+
+// Abandon the stroke in progress and restore the pixels it touched
+void cancelStroke() {
+    if (!strokeOpen) {
+        return;
     }
+    applyStrokeOp(collab::StrokeOpType::Cancel, 0, 0);
+    cout << "Drawing cancelled" << endl;
+}
+
+// Select the active tool, abandoning any stroke in progress
+void selectTool(int id) {
+    cancelStroke();
+    textLabels.finishEditing();
+    currentTool = id;
+    cout << "Tool: " << engine.tools().name(id) << endl;
+}
+
+// Anchor the canvas to the current frame
+void resetAnchor() {
+    if (!stabilize) {
+        return;
+    }
+    anchorTransform = Matx33d::eye();
+    anchorInverse = Matx33d::eye();
+    engine.compositor().setTransform(anchorTransform);
+}
+
+// Fold the camera motion measured by the tracker into the anchor transform
+void updateAnchor(double waitMs) {
+    Matx33d motion;
+    if (!motionTracker.collect(motion, waitMs)) {
+        return;
+    }
+    anchorTransform = motion * anchorTransform;
+    anchorInverse = anchorTransform.inv();
+    engine.compositor().setTransform(anchorTransform);
+}
+
+// Apply a homography to a point, clamped to a band one canvas wide around
+// the canvas so a near-degenerate transform cannot produce huge coordinates
+Point mapPoint(const Matx33d& h, double x, double y) {
+    double w = h(2, 0) * x + h(2, 1) * y + h(2, 2);
+    if (std::abs(w) < 1e-9) {
+        w = 1e-9;
+    }
+    int cols = std::max(engine.canvas().cols, frame.cols);
+    int rows = std::max(engine.canvas().rows, frame.rows);
+    double px = (h(0, 0) * x + h(0, 1) * y + h(0, 2)) / w;
+    double py = (h(1, 0) * x + h(1, 1) * y + h(1, 2)) / w;
+    return Point(cvRound(std::min(std::max(px, -1.0 * cols), 2.0 * cols)),
+                 cvRound(std::min(std::max(py, -1.0 * rows), 2.0 * rows)));
+}
+
+// Map a point on screen to canvas coordinates
+Point canvasPoint(int x, int y) {
+    if (!stabilize) {
+        return Point(x, y);
+    }
+    return mapPoint(anchorInverse, x, y);
+}
+
+// Whether a canvas point lies on the canvas; with a moving camera parts of
+// the view were never part of the anchor frame and hold no canvas pixels
+bool onCanvas(const Point& p) {
+    return p.x >= 0 && p.y >= 0 && p.x < engine.canvas().cols && p.y < engine.canvas().rows;
+}
+
+// Called by the engine after a local or remote clear
+void canvasCleared(bool remote) {
+    if (!remote) {
+        textLabels.clear();
+    }
+    resetAnchor();
 }
 
 // Undo function
 void undo() {
-    if (!undoStack.empty()) {
-        redoStack.push(doodleLayer.clone());
-        doodleLayer = undoStack.top().clone();
-        undoStack.pop();
+    cancelStroke();
+    applySyncedStrokes();
+    if (engine.undo()) {
         cout << "Undo performed" << endl;
     } else {
         cout << "Nothing to undo" << endl;
@@ -88,126 +229,171 @@ void undo() {
 
 // Redo function
 void redo() {
-    if (!redoStack.empty()) {
-        undoStack.push(doodleLayer.clone());
-        doodleLayer = redoStack.top().clone();
-        redoStack.pop();
+    cancelStroke();
+    applySyncedStrokes();
+    if (engine.redo()) {
         cout << "Redo performed" << endl;
     } else {
         cout << "Nothing to redo" << endl;
     }
 }
 
-// Spray paint effect
-void sprayPaint(Mat& img, Point center, Scalar color, int radius) {
-    int numParticles = radius * 2;
-    for (int i = 0; i < numParticles; i++) {
-        int offsetX = distribution(generator) * radius / 10;
-        int offsetY = distribution(generator) * radius / 10;
-        Point particle = Point(center.x + offsetX, center.y + offsetY);
-        if (particle.x >= 0 && particle.x < img.cols && particle.y >= 0 && particle.y < img.rows) {
-            circle(img, particle, 1, color, -1);
+// Drop the oldest history level when history is over its memory budget
+bool trimHistory() {
+    return engine.history().trimOldest();
+}
+
+// Drop idle tools and their shape-preview buffers when previews are over budget
+bool releasePreviews() {
+    return engine.releaseIdleTools();
+}
+
+// Drop cached glyphs when the UI is over budget; they are rasterized again on use
+bool releaseGlyphs() {
+    if (glyphAtlas.atlasBytes() == 0) {
+        return false;
+    }
+    glyphAtlas.clear();
+    return true;
+}
+
+// Apply a local stroke operation and queue it for the collaborative session;
+// returns the canvas region it changed
+Rect applyStrokeOp(collab::StrokeOpType type, int x, int y) {
+    collab::StrokeOp op;
+    op.type = type;
+    op.x = x;
+    op.y = y;
+    if (type == collab::StrokeOpType::Begin) {
+        op.tool = static_cast<uint8_t>(currentTool);
+        op.size = saturate_cast<uchar>(brushSize);
+        for (int c = 0; c < 3; c++) {
+            op.color[c] = saturate_cast<uchar>(drawColor[c]);
         }
+        op.seed = generator();
+    }
+    if (type == collab::StrokeOpType::Begin) {
+        strokeOpen = true;
+    } else if (type == collab::StrokeOpType::End || type == collab::StrokeOpType::Cancel) {
+        strokeOpen = false;
     }
+    // In a session the operation is drawn once poll() has put it in order
+    if (syncEnabled) {
+        syncPeer.record(op);
+        return Rect();
+    }
+    return engine.apply(op);
 }
 
-// Flood fill function
-void floodFillTool(Mat& img, Point seed, Scalar newColor) {
-    if (seed.x < 0 || seed.x >= img.cols || seed.y < 0 || seed.y >= img.rows) {
+// Send the operations queued since the last call as one batch, then apply
+// every instance's batches, this one's included, in the session's order
+void applySyncedStrokes() {
+    if (!syncEnabled) {
         return;
     }
-    Scalar tolerance = Scalar(10, 10, 10);
-    floodFill(img, seed, newColor, nullptr, tolerance, tolerance, FLOODFILL_FIXED_RANGE);
+    syncPeer.flush();
+    syncPeer.poll(syncedBatches);
+    for (const auto& batch : syncedBatches) {
+        if (batch.instanceId != syncPeer.instanceId()) {
+            engine.applyRemote(batch);
+            continue;
+        }
+        // As without a session, inputs that drew nothing are not tracked
+        if (!engine.apply(batch.ops.data(), batch.ops.size()).empty()) {
+            for (const auto& inputTime : syncedInputs) {
+                latencyTracker.addInput(inputTime);
+            }
+        }
+        syncedInputs.clear();
+    }
 }
 
-// Mouse callback function
-void mouseCallback(int event, int x, int y, int flags, void* userdata) {
+// Handle a mouse event in canvas coordinates; returns the canvas region it changed
+Rect handleMouse(int event, int x, int y, int flags) {
+    Point p = canvasPoint(x, y);
+    Rect damage;
     
     if (event == EVENT_LBUTTONDOWN) {
         // Check if clicking on color palette
-        if (showColorPalette && y < 60 && x > 10 && x < 10 + colorPalette.size() * 40) {
-            int colorIndex = (x - 10) / 40;
-            if (colorIndex < colorPalette.size()) {
-                drawColor = colorPalette[colorIndex];
-                cout << "Color changed" << endl;
-                return;
-            }
+        int paletteWidth = static_cast<int>(colorPalette.size()) * 40;
+        if (showColorPalette && hudVisible && y < 60 && x > 10 && x < 10 + paletteWidth) {
+            drawColor = colorPalette[(x - 10) / 40];
+            cout << "Color changed" << endl;
+            return damage;
         }
-        
-        drawing = true;
-        lastPoint = Point(x, y);
-        startPoint = Point(x, y);
-        
-        if (currentTool == FILL) {
-            saveState();
-            floodFillTool(doodleLayer, Point(x, y), drawColor);
-            cout << "Fill applied at: (" << x << ", " << y << ")" << endl;
-        } else if (currentTool == SPRAY) {
-            saveState();
-            sprayPaint(doodleLayer, Point(x, y), drawColor, brushSize * 2);
-        } else if (currentTool == BRUSH || currentTool == ERASER) {
-            saveState();
-        } else {
-            // For shape tools, save state when drawing starts
-            tempLayer = doodleLayer.clone();
+        if (!engine.tools().valid(currentTool)) {
+            return damage;
+        }
+        // The canvas does not grow with the view; strokes must start on it
+        if (!onCanvas(p)) {
+            cout << "Outside the anchored canvas; press C to re-anchor here" << endl;
+            return damage;
         }
         
+        damage = applyStrokeOp(collab::StrokeOpType::Begin, p.x, p.y);
         cout << "Drawing started at: (" << x << ", " << y << ")" << endl;
     }
     
-    else if (event == EVENT_MOUSEMOVE && drawing) {
-        if (currentTool == BRUSH) {
-            line(doodleLayer, lastPoint, Point(x, y), drawColor, brushSize, LINE_AA);
-            lastPoint = Point(x, y);
-        }
-        else if (currentTool == ERASER) {
-            line(doodleLayer, lastPoint, Point(x, y), backgroundColor, brushSize * 2, LINE_AA);
-            lastPoint = Point(x, y);
-        }
-        else if (currentTool == SPRAY) {
-            sprayPaint(doodleLayer, Point(x, y), drawColor, brushSize * 2);
-        }
-        else if (currentTool == LINE) {
-            doodleLayer = tempLayer.clone();
-            line(doodleLayer, startPoint, Point(x, y), drawColor, brushSize, LINE_AA);
-        }
-        else if (currentTool == RECTANGLE) {
-            doodleLayer = tempLayer.clone();
-            rectangle(doodleLayer, startPoint, Point(x, y), drawColor, brushSize);
-        }
-        else if (currentTool == CIRCLE) {
-            doodleLayer = tempLayer.clone();
-            int radius = (int)sqrt(pow(x - startPoint.x, 2) + pow(y - startPoint.y, 2));
-            circle(doodleLayer, startPoint, radius, drawColor, brushSize);
-        }
-        else if (currentTool == ELLIPSE) {
-            doodleLayer = tempLayer.clone();
-            int width = abs(x - startPoint.x);
-            int height = abs(y - startPoint.y);
-            Point center = Point((startPoint.x + x) / 2, (startPoint.y + y) / 2);
-            ellipse(doodleLayer, center, Size(width / 2, height / 2), 0, 0, 360, drawColor, brushSize);
-        }
+    else if (event == EVENT_MOUSEMOVE && strokeOpen) {
+        damage = applyStrokeOp(collab::StrokeOpType::Move, p.x, p.y);
     }
     
-    else if (event == EVENT_LBUTTONUP) {
-        if (drawing && (currentTool >= LINE && currentTool <= ELLIPSE)) {
-            saveState();
-        }
-        drawing = false;
+    else if (event == EVENT_LBUTTONUP && strokeOpen) {
+        damage = applyStrokeOp(collab::StrokeOpType::End, p.x, p.y);
         cout << "Drawing stopped" << endl;
     }
     
+    else if (event == EVENT_RBUTTONDOWN && strokeOpen) {
+        cancelStroke();
+    }
+    
     else if (event == EVENT_MOUSEWHEEL) {
         if (flags > 0) {
             brushSize += 1;
-            if (brushSize > 20) brushSize = 20;
+            if (brushSize > config.maxBrushSize) brushSize = config.maxBrushSize;
             cout << "Brush size: " << brushSize << endl;
         } else {
             brushSize -= 1;
-            if (brushSize < 1) brushSize = 1;
+            if (brushSize < config.minBrushSize) brushSize = config.minBrushSize;
             cout << "Brush size: " << brushSize << endl;
         }
     }
+    return damage;
+}
+
+// Handle a mouse event and track its latency if it drew anything
+void dispatchMouseEvent(const RecordedInput& input,
+                        performance::LatencyTracker::Clock::time_point inputTime) {
+    inputRecorder.record(input);
+    
+    // Only inputs that changed canvas pixels count; text-tool clicks and
+    // drags edit labels and never report damage
+    size_t queued = syncPeer.queued();
+    bool drew = !handleMouse(input.event, input.x, input.y, input.flags).empty();
+    if (drew) {
+        latencyTracker.addInput(inputTime);
+    } else if (syncPeer.queued() > queued) {
+        syncedInputs.push_back(inputTime);
+    }
+}
+
+// Mouse callback function
+void mouseCallback(int event, int x, int y, int flags, void* userdata) {
+    auto inputTime = performance::LatencyTracker::now();
+    
+    // Map from the (possibly downscaled) preview back to frame coordinates
+    if (previewScale != 1.0) {
+        x = cvRound(x / previewScale);
+        y = cvRound(y / previewScale);
+    }
+    
+    RecordedInput input;
+    input.frame = frameIndex;
+    input.event = event;
+    input.x = x;
+    input.y = y;
+    input.flags = flags;
+    dispatchMouseEvent(input, inputTime);
 }
 
 // Draw color palette
@@ -231,6 +417,31 @@ void drawColorPalette(Mat& img) {
                       Scalar(255, 255, 0), 3);
         }
     }
+    
+    // An indexed canvas with every slot taken paints the nearest color instead
+    if (engine.indexed() && engine.palette().wouldRemap(drawColor)) {
+        glyphAtlas.drawText(img, "Palette full: nearest color used",
+                            Point(startX, startY + size + 20), FONT_HERSHEY_SIMPLEX, 0.5,
+                            Scalar(0, 128, 255), 1);
+    }
+}
+
+// Outline the anchored canvas once the camera has moved, showing where the
+// view holds no canvas to draw on
+void drawCanvasBounds(Mat& img) {
+    if (!stabilize || engine.empty()) {
+        return;
+    }
+    double cols = engine.canvas().cols;
+    double rows = engine.canvas().rows;
+    Point corners[4] = {mapPoint(anchorTransform, 0, 0), mapPoint(anchorTransform, cols, 0),
+                        mapPoint(anchorTransform, cols, rows), mapPoint(anchorTransform, 0, rows)};
+    if (corners[0] == Point(0, 0) && corners[2] == Point(img.cols, img.rows)) {
+        return;
+    }
+    for (int i = 0; i < 4; i++) {
+        line(img, corners[i], corners[(i + 1) % 4], Scalar(0, 200, 255), 1, LINE_AA);
+    }
 }
 
 // Draw help text on frame
@@ -239,34 +450,61 @@ void drawHelpText(Mat& img) {
     double fontScale = 0.45;
     int thickness = 1;
     Scalar textColor = Scalar(255, 255, 255);
-    int lineType = LINE_AA;
     
-    rectangle(img, Point(10, 70), Point(350, 380), Scalar(0, 0, 0, 180), -1);
-    rectangle(img, Point(10, 70), Point(350, 380), Scalar(255, 255, 255), 2);
+    rectangle(img, Point(10, 70), Point(350, 395), Scalar(0, 0, 0, 180), -1);
+    rectangle(img, Point(10, 70), Point(350, 395), Scalar(255, 255, 255), 2);
     
-    putText(img, "ADVANCED CONTROLS:", Point(20, 90), fontFace, 0.5, textColor, thickness + 1, lineType);
-    putText(img, "===================", Point(20, 105), fontFace, fontScale, textColor, thickness, lineType);
+    glyphAtlas.drawText(img, "ADVANCED CONTROLS:", Point(20, 90),
+                        fontFace, 0.5, textColor, thickness + 1);
+    glyphAtlas.drawText(img, "===================", Point(20, 105),
+                        fontFace, fontScale, textColor, thickness);
     
-    putText(img, "DRAWING:", Point(20, 125), fontFace, fontScale, Scalar(0, 255, 255), thickness, lineType);
-    putText(img, "  Left Click & Drag: Draw", Point(20, 145), fontFace, fontScale, textColor, thickness, lineType);
-    putText(img, "  Scroll Wheel: Brush Size", Point(20, 160), fontFace, fontScale, textColor, thickness, lineType);
-    putText(img, "  Click Palette: Change Color", Point(20, 175), fontFace, fontScale, textColor, thickness, lineType);
+    glyphAtlas.drawText(img, "DRAWING:", Point(20, 125),
+                        fontFace, fontScale, Scalar(0, 255, 255), thickness);
+    glyphAtlas.drawText(img, "  Left Drag: Draw  Right Click: Cancel", Point(20, 145),
+                        fontFace, fontScale, textColor, thickness);
+    glyphAtlas.drawText(img, "  Scroll Wheel: Brush Size", Point(20, 160),
+                        fontFace, fontScale, textColor, thickness);
+    glyphAtlas.drawText(img, "  Click Palette: Change Color", Point(20, 175),
+                        fontFace, fontScale, textColor, thickness);
     
-    putText(img, "TOOLS: (1-8 keys)", Point(20, 195), fontFace, fontScale, Scalar(0, 255, 255), thickness, lineType);
-    putText(img, "  1: Brush  2: Eraser  3: Line", Point(20, 210), fontFace, fontScale, textColor, thickness, lineType);
-    putText(img, "  4: Rectangle  5: Circle", Point(20, 225), fontFace, fontScale, textColor, thickness, lineType);
-    putText(img, "  6: Ellipse  7: Spray  8: Fill", Point(20, 240), fontFace, fontScale, textColor, thickness, lineType);
+    glyphAtlas.drawText(img, "TOOLS: (1-9 keys)", Point(20, 195),
+                        fontFace, fontScale, Scalar(0, 255, 255), thickness);
+    glyphAtlas.drawText(img, "  1: Brush  2: Eraser  3: Line", Point(20, 210),
+                        fontFace, fontScale, textColor, thickness);
+    glyphAtlas.drawText(img, "  4: Rectangle  5: Circle", Point(20, 225),
+                        fontFace, fontScale, textColor, thickness);
+    glyphAtlas.drawText(img, "  6: Ellipse  7: Spray  8: Fill  9: Text", Point(20, 240),
+                        fontFace, fontScale, textColor, thickness);
     
-    putText(img, "ACTIONS:", Point(20, 260), fontFace, fontScale, Scalar(0, 255, 255), thickness, lineType);
-    putText(img, "  C: Clear Canvas", Point(20, 275), fontFace, fontScale, textColor, thickness, lineType);
-    putText(img, "  Z: Undo  X: Redo", Point(20, 290), fontFace, fontScale, textColor, thickness, lineType);
-    putText(img, "  S: Save Drawing", Point(20, 305), fontFace, fontScale, textColor, thickness, lineType);
-    putText(img, "  P: Toggle Palette", Point(20, 320), fontFace, fontScale, textColor, thickness, lineType);
-    putText(img, "  H: Toggle Help", Point(20, 335), fontFace, fontScale, textColor, thickness, lineType);
-    putText(img, "  ESC: Exit", Point(20, 350), fontFace, fontScale, textColor, thickness, lineType);
+    glyphAtlas.drawText(img, "ACTIONS:", Point(20, 260),
+                        fontFace, fontScale, Scalar(0, 255, 255), thickness);
+    glyphAtlas.drawText(img, "  C: Clear Canvas", Point(20, 275),
+                        fontFace, fontScale, textColor, thickness);
+    glyphAtlas.drawText(img, "  Z: Undo  X: Redo", Point(20, 290),
+                        fontFace, fontScale, textColor, thickness);
+    glyphAtlas.drawText(img, "  S: Save PNG  W: Save Project", Point(20, 305),
+                        fontFace, fontScale, textColor, thickness);
+    glyphAtlas.drawText(img, "  P: Toggle Palette  K: Chroma Key", Point(20, 320),
+                        fontFace, fontScale, textColor, thickness);
+    glyphAtlas.drawText(img, "  H: Toggle Help  B: Learn Background", Point(20, 335),
+                        fontFace, fontScale, textColor, thickness);
+    glyphAtlas.drawText(img, "  F: Toggle Stats", Point(20, 350),
+                        fontFace, fontScale, textColor, thickness);
+    glyphAtlas.drawText(img, "  ESC: Exit", Point(20, 365),
+                        fontFace, fontScale, textColor, thickness);
     
-    string info = "Tool: " + toolNames[currentTool] + " | Size: " + to_string(brushSize) + "px";
-    putText(img, info, Point(20, 370), fontFace, fontScale, Scalar(0, 255, 0), thickness, lineType);
+    char info[64];
+    snprintf(info, sizeof(info), "Tool: %s | Size: %dpx", engine.tools().name(currentTool).c_str(),
+             brushSize);
+    glyphAtlas.drawText(img, info, Point(20, 385),
+                        fontFace, fontScale, Scalar(0, 255, 0), thickness);
+}
+
+// Draw statistics text through the glyph atlas
+void drawOverlayText(Mat& img, const char* text, Point org, double fontScale,
+                     const Scalar& color, int thickness) {
+    glyphAtlas.drawText(img, text, org, FONT_HERSHEY_SIMPLEX, fontScale, color, thickness);
 }
 
 // Save drawing to file
@@ -278,12 +516,131 @@ void saveDrawing() {
             1900 + ltm->tm_year, 1 + ltm->tm_mon, ltm->tm_mday,
             ltm->tm_hour, ltm->tm_min, ltm->tm_sec);
     
-    imwrite(filename, doodleLayer);
+    performance::ScopedMemoryTag tag(performance::MemoryTag::Export);
+    Mat image;
+    engine.render(image);
+    textLabels.draw(image);
+    imwrite(filename, image);
     cout << "Drawing saved as: " << filename << endl;
 }
 
+// Save the canvas, history and labels as a project, rewriting only changed tiles
+void saveProject() {
+    cancelStroke();
+    textLabels.finishEditing();
+    if (project.save(projectPath, engine.canvas(), &engine.history(), textLabels.labels(),
+                     engine.palette().colors())) {
+        cout << "Project saved as: " << projectPath << endl;
+    } else {
+        cerr << "Error: Cannot save project: " << project.error() << endl;
+    }
+}
+
+// Take history and labels from the opened project once the canvas exists
+void restoreProject() {
+    if (!project.isOpen()) {
+        return;
+    }
+    const Mat& canvas = engine.canvas();
+    if (project.canvasSize() != canvas.size() || project.canvasType() != canvas.type()) {
+        cerr << "Warning: " << projectPath << " does not match the camera resolution "
+             << "or canvas storage, starting a new project" << endl;
+        project.close();
+        return;
+    }
+    deque<doodle::History::Patch> undoLevels, redoLevels;
+    if (project.loadHistory(undoLevels, redoLevels)) {
+        size_t dropped = engine.history().restore(std::move(undoLevels), std::move(redoLevels));
+        if (dropped > 0) {
+            cerr << "Warning: dropped " << dropped << " undo/redo levels of " << projectPath
+                 << " that do not match the canvas" << endl;
+        }
+    }
+    textLabels.assign(project.labels());
+    engine.palette().assign(project.palette());
+}
+
+// Part of the canvas that is currently on screen
+Rect visibleCanvasRect() {
+    Rect all(0, 0, engine.canvas().cols, engine.canvas().rows);
+    if (!stabilize) {
+        return all;
+    }
+    Point corners[4] = {canvasPoint(0, 0), canvasPoint(frame.cols, 0),
+                        canvasPoint(frame.cols, frame.rows), canvasPoint(0, frame.rows)};
+    Rect bounds;
+    for (const Point& corner : corners) {
+        bounds |= Rect(corner, Size(1, 1));
+    }
+    return bounds & all;
+}
+
+// Parse a whole command-line argument as an integer in [minValue, maxValue]
+bool parseInteger(const char* text, long long minValue, long long maxValue, long long& value) {
+    errno = 0;
+    char* end = nullptr;
+    long long parsed = strtoll(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || parsed < minValue ||
+        parsed > maxValue) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// Print command line usage
+void printUsage(const char* program) {
+    cout << "Usage: " << program << " [options]" << endl;
+    cout << "  --config PATH            Settings file (default: config.json)" << endl;
+    cout << "  --video PATH             Read frames from a video file" << endl;
+    cout << "  --headless               Run without a window" << endl;
+    cout << "  --frames N               Stop after N frames" << endl;
+    cout << "  --record-events PATH     Record mouse input" << endl;
+    cout << "  --replay-events PATH     Replay recorded mouse input" << endl;
+    cout << "  --sync-listen ENDPOINT   Host a shared drawing session" << endl;
+    cout << "  --sync-connect ENDPOINT  Join a shared drawing session" << endl;
+    cout << "  --stabilize              Keep drawings fixed to the scene" << endl;
+    cout << "  --project PATH           Open or create a project (default: session.ldp)" << endl;
+    cout << "  --shm-output NAME        Publish frames to shared memory (e.g. /livedoodle)" << endl;
+    cout << "  --mjpeg-port PORT        Serve an MJPEG preview on 127.0.0.1:PORT" << endl;
+    cout << "  --chroma-key MODE        Key out the background: color or background" << endl;
+    cout << "  --replace-image PATH     Show an image where the background was keyed out" << endl;
+    cout << "  --indexed-canvas         Store the canvas as palette indices (1 byte/pixel)" << endl;
+    cout << "  ENDPOINT is unix:/path/to.sock or tcp:host:port" << endl;
+}
+
+// Set up the chroma key from the settings
+void configureChromaKey() {
+    doodle::ChromaKey::Settings settings;
+    if (!doodle::ChromaKey::parseMode(config.chromaKey, settings.mode)) {
+        cerr << "Warning: unknown chroma key mode " << config.chromaKey << endl;
+    }
+    if (!doodle::ChromaKey::parseReplacement(config.keyReplacement, settings.replacement)) {
+        cerr << "Warning: unknown chroma key replacement " << config.keyReplacement << endl;
+    }
+    settings.keyColor = config.keyColor;
+    settings.hueTolerance = config.keyHueTolerance;
+    settings.softness = config.keySoftness;
+    settings.minSaturation = config.keyMinSaturation;
+    settings.minValue = config.keyMinValue;
+    settings.backgroundThreshold = config.keyBackgroundThreshold;
+    settings.learnFrames = config.keyLearnFrames;
+    settings.replaceColor = config.keyReplaceColor;
+    
+    if (settings.replacement == doodle::ChromaKey::Replacement::Image &&
+        !chromaKey.setReplacementImage(imread(config.keyReplaceImage, IMREAD_COLOR))) {
+        cerr << "Warning: Cannot read replacement image " << config.keyReplaceImage
+             << ", using the replacement color" << endl;
+        settings.replacement = doodle::ChromaKey::Replacement::Color;
+    }
+    chromaKey.configure(settings);
+    if (chromaKey.enabled()) {
+        cout << "Chroma key: " << config.chromaKey << endl;
+    }
+}
+
 // Main function
-int main() {
+int main(int argc, char** argv) {
     cout << "======================================" << endl;
     cout << "  Live Doodle on Camera - ADVANCED  " << endl;
     cout << "======================================" << endl << endl;
@@ -291,9 +648,144 @@ int main() {
     // Initialize random seed
     generator.seed(time(0));
     
+    // Account all image memory per subsystem
+    performance::TrackingMatAllocator::install();
+    
+    // Parse command line
+    string configPath = "config.json";
+    string videoPath;
+    bool headless = false;
+    uint64_t maxFrames = 0;
+    string chromaKeyMode;
+    string replaceImage;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--config" && i + 1 < argc) {
+            configPath = argv[++i];
+        } else if (arg == "--video" && i + 1 < argc) {
+            videoPath = argv[++i];
+        } else if (arg == "--project" && i + 1 < argc) {
+            projectPath = argv[++i];
+            if (project.open(projectPath)) {
+                cout << "Opened project " << projectPath << endl;
+            } else {
+                cout << "New project " << projectPath << " (" << project.error() << ")" << endl;
+            }
+        } else if (arg == "--shm-output" && i + 1 < argc) {
+            shmOutput = argv[++i];
+        } else if (arg == "--mjpeg-port" && i + 1 < argc) {
+            long long port;
+            if (!parseInteger(argv[++i], 0, 65535, port)) {
+                cerr << "Error: Invalid port " << argv[i] << endl;
+                return -1;
+            }
+            mjpegPort = static_cast<int>(port);
+        } else if (arg == "--chroma-key" && i + 1 < argc) {
+            chromaKeyMode = argv[++i];
+        } else if (arg == "--replace-image" && i + 1 < argc) {
+            replaceImage = argv[++i];
+        } else if (arg == "--indexed-canvas") {
+            canvasType = CV_8UC1;
+        } else if (arg == "--stabilize") {
+            stabilize = true;
+        } else if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--frames" && i + 1 < argc) {
+            long long frames;
+            if (!parseInteger(argv[++i], 0, LLONG_MAX, frames)) {
+                cerr << "Error: Invalid frame count " << argv[i] << endl;
+                return -1;
+            }
+            maxFrames = static_cast<uint64_t>(frames);
+        } else if (arg == "--record-events" && i + 1 < argc) {
+            if (!inputRecorder.open(argv[++i])) {
+                cerr << "Error: Cannot write " << argv[i] << endl;
+                return -1;
+            }
+        } else if (arg == "--replay-events" && i + 1 < argc) {
+            if (!inputReplayer.load(argv[++i])) {
+                cerr << "Error: Cannot read " << argv[i] << endl;
+                return -1;
+            }
+        } else if ((arg == "--sync-listen" || arg == "--sync-connect") && i + 1 < argc) {
+            string endpoint = argv[++i];
+            bool ok = (arg == "--sync-listen") ? syncPeer.listen(endpoint)
+                                               : syncPeer.connect(endpoint);
+            if (!ok) {
+                cerr << "Error: " << syncPeer.error() << endl;
+                return -1;
+            }
+            syncEnabled = true;
+            cout << "Collaborative session on " << endpoint << endl;
+        } else {
+            printUsage(argv[0]);
+            return (arg == "--help" || arg == "-h") ? 0 : -1;
+        }
+    }
+    
+    // Load settings
+    if (loadConfiguration(configPath, config)) {
+        cout << "Loaded settings from " << configPath << endl;
+    } else {
+        cout << "Using default settings (" << configPath << " not found)" << endl;
+    }
+    brushSize = config.defaultBrushSize;
+    showHelp = config.showHelpOnStartup;
+    showColorPalette = config.showColorPalette;
+    framePacer.setTargetFps(config.cameraFps);
+    stabilize = stabilize || config.stabilize;
+    if (config.canvasStorage == "indexed") {
+        canvasType = CV_8UC1;
+    }
+    // A project keeps the storage it was created with
+    if (project.isOpen() &&
+        (project.canvasType() == CV_8UC1 || project.canvasType() == CV_8UC3)) {
+        canvasType = project.canvasType();
+    }
+    if (shmOutput.empty()) {
+        shmOutput = config.shmOutput;
+    }
+    if (mjpegPort < 0) {
+        mjpegPort = config.mjpegPort;
+    }
+    if (!chromaKeyMode.empty()) {
+        config.chromaKey = chromaKeyMode;
+    }
+    if (!replaceImage.empty()) {
+        config.keyReplacement = "image";
+        config.keyReplaceImage = replaceImage;
+    }
+    configureChromaKey();
+    
+    // Memory budgets
+    using performance::MemoryAccountant;
+    using performance::MemoryTag;
+    const int64_t MB = 1024 * 1024;
+    MemoryAccountant::setBudget(MemoryTag::Canvas, config.canvasBudgetMB * MB);
+    MemoryAccountant::setBudget(MemoryTag::History, config.historyBudgetMB * MB);
+    MemoryAccountant::setBudget(MemoryTag::Preview, config.previewBudgetMB * MB);
+    MemoryAccountant::setBudget(MemoryTag::UI, config.uiBudgetMB * MB);
+    MemoryAccountant::setBudget(MemoryTag::Export, config.exportBudgetMB * MB);
+    // Canvas and export budgets are warn-only: nothing there can be dropped
+    MemoryAccountant::setEvictionHandler(MemoryTag::History, trimHistory);
+    MemoryAccountant::setEvictionHandler(MemoryTag::Preview, releasePreviews);
+    MemoryAccountant::setEvictionHandler(MemoryTag::UI, releaseGlyphs);
+    engine.history().setMaxDepth(config.maxUndoLevels);
+    engine.setBackground(backgroundColor);
+    engine.setLabels(&textLabels);
+    engine.onPrepare(ensureCanvasLoaded);
+    engine.onDamage([](const Rect& damage) { project.markDirty(damage); });
+    engine.onClear(canvasCleared);
+    performance::overlayTextRenderer() = drawOverlayText;
+    
     // Initialize camera
     cout << "Initializing camera..." << endl;
-    VideoCapture camera(0);
+    VideoCapture camera;
+    if (videoPath.empty()) {
+        camera.open(config.cameraDeviceId);
+    } else {
+        camera.open(videoPath);
+    }
     
     if (!camera.isOpened()) {
         cerr << "Error: Cannot open camera. Check if it's connected." << endl;
@@ -301,100 +793,217 @@ int main() {
     }
     cout << "Camera initialized successfully" << endl;
     
-    // Set camera resolution
-    camera.set(CAP_PROP_FRAME_WIDTH, 640);
-    camera.set(CAP_PROP_FRAME_HEIGHT, 480);
+    // Set camera resolution and frame rate
+    if (videoPath.empty()) {
+        camera.set(CAP_PROP_FRAME_WIDTH, config.frameWidth);
+        camera.set(CAP_PROP_FRAME_HEIGHT, config.frameHeight);
+        camera.set(CAP_PROP_FPS, config.cameraFps);
+    }
     
-    // Create window
-    cout << "Creating display window..." << endl;
-    string windowName = "Live Doodle on Camera - Advanced";
-    namedWindow(windowName, WINDOW_AUTOSIZE);
+    string windowName = config.windowTitle;
+    if (!headless) {
+        // Create window
+        cout << "Creating display window..." << endl;
+        namedWindow(windowName, WINDOW_AUTOSIZE);
+        
+        // Register mouse callback
+        cout << "Registering mouse callback..." << endl;
+        setMouseCallback(windowName, mouseCallback, nullptr);
+    }
     
-    // Register mouse callback
-    cout << "Registering mouse callback..." << endl;
-    setMouseCallback(windowName, mouseCallback, nullptr);
+    // Browser preview of the annotated feed
+    if (mjpegPort > 0) {
+        doodle::MjpegServer::Settings settings;
+        settings.port = mjpegPort;
+        settings.quality = config.mjpegQuality;
+        if (mjpegServer.start(settings)) {
+            cout << "MJPEG preview at http://127.0.0.1:" << mjpegPort << "/" << endl;
+        } else {
+            cerr << "Warning: " << mjpegServer.error() << endl;
+        }
+    }
+    
+    // Start camera-motion tracking for scene-anchored drawing
+    if (stabilize) {
+        doodle::MotionTracker::Settings settings;
+        settings.maxFeatures = config.stabilizeMaxFeatures;
+        settings.trackWidth = config.stabilizeTrackWidth;
+        motionTracker.start(settings);
+        resetAnchor();
+        cout << "Scene-anchored drawing enabled" << endl;
+    }
     
     // Print instructions
     cout << endl << "NEW FEATURES:" << endl;
     cout << "======================================" << endl;
-    cout << "✓ Undo/Redo (Z/X keys)" << endl;
-    cout << "✓ Multiple drawing tools (1-8)" << endl;
-    cout << "✓ Shape tools (Line, Rectangle, Circle, Ellipse)" << endl;
-    cout << "✓ Spray paint & Fill tool" << endl;
-    cout << "✓ Eraser tool" << endl;
-    cout << "✓ Color palette" << endl;
-    cout << "✓ Save drawings (S key)" << endl;
-    cout << "✓ Enhanced controls" << endl;
+    // Tool keys come from the registry, so the list always matches the bindings
+    cout << "✓ Tools:";
+    for (size_t i = 0; i < engine.tools().size(); i++) {
+        int id = static_cast<int>(i);
+        cout << (i == 0 ? " " : ", ") << static_cast<char>(engine.tools().key(id)) << " "
+             << engine.tools().name(id);
+    }
+    cout << endl;
+    cout << "✓ Undo/Redo (Z/X keys), Clear (C key)" << endl;
+    cout << "✓ Save PNG (S key), Save project (W key)" << endl;
+    cout << "✓ Color palette (P key), Chroma key (K/B keys)" << endl;
+    cout << "✓ Help (H key), Stats overlay (F key)" << endl;
     cout << "======================================" << endl << endl;
     
     cout << "Program is running. Press H for help, ESC to exit." << endl << endl;
     
     // Main loop
-    while (true) {
+    for (frameIndex = 0; maxFrames == 0 || frameIndex < maxFrames; frameIndex++) {
         camera >> frame;
         
         if (frame.empty()) {
-            cerr << "Error: Failed to capture frame." << endl;
+            if (videoPath.empty()) {
+                cerr << "Error: Failed to capture frame." << endl;
+            } else {
+                cout << "End of video" << endl;
+            }
             break;
         }
         
-        if (doodleLayer.empty()) {
-            doodleLayer = Mat::zeros(frame.size(), CV_8UC3);
-            tempLayer = Mat::zeros(frame.size(), CV_8UC3);
+        latencyTracker.markCapture();
+        allocationMonitor.beginFrame();
+        // The frame deadline runs from capture, so keying counts against it
+        framePacer.beginFrame();
+        if (stabilize) {
+            motionTracker.submit(frame);
         }
         
-        Mat output;
-        addWeighted(frame, 1.0, doodleLayer, 1.0, 0, output);
+        // Replace the background; motion tracking above still sees the real scene
+        bool keyed = chromaKey.process(frame, keyedFrame);
+        fpsCounter.update();
+        engine.setLineType(framePacer.lineType());
+        hudVisible = framePacer.showHud();
+        previewScale = framePacer.previewScale();
         
-        if (showColorPalette) {
-            drawColorPalette(output);
+        if (engine.empty()) {
+            engine.reset(frame.size(), canvasType);
+            restoreProject();
         }
         
-        if (showHelp) {
-            drawHelpText(output);
+        // Follow the camera; headless runs wait for every frame so replays are exact
+        if (stabilize) {
+            updateAnchor(headless ? -1.0 : config.stabilizeBudgetMs);
         }
         
-        imshow(windowName, output);
+        // Decode saved tiles as they come into view
+        loadProjectTiles(visibleCanvasRect());
         
-        int key = waitKey(1) & 0xFF;
+        // Feed recorded input that arrived during this frame
+        inputReplayer.replay(frameIndex, [](const RecordedInput& input) {
+            dispatchMouseEvent(input, performance::LatencyTracker::now());
+        });
         
-        // Tool selection
-        if (key == '1') {
-            currentTool = BRUSH;
-            cout << "Tool: Brush" << endl;
+        // Apply local and remote strokes in the session's order
+        applySyncedStrokes();
+        
+        // Keep every subsystem within its memory budget
+        MemoryAccountant::enforceBudgets();
+        
+        // Blend only where the canvas has ever been drawn on
+        output = outputPool.acquire(frame.size(), frame.type());
+        engine.composite(keyed ? keyedFrame : frame, output);
+        textLabels.draw(output, anchorTransform);
+        latencyTracker.markComposited();
+        
+        // Other processes get the annotated feed without the HUD
+        if (!shmOutput.empty()) {
+            // With a transparent key, the keyed-out background goes out as alpha
+            const Mat* published = &output;
+            if (chromaKey.transparent()) {
+                chromaKey.exportTransparent(output, transparentOutput);
+                published = &transparentOutput;
+            }
+            if (!frameRing.isOpen()) {
+                if (frameRing.create(shmOutput, published->size(), published->type(),
+                                     config.shmSlots)) {
+                    cout << "Publishing frames to shared memory " << shmOutput << endl;
+                } else {
+                    cerr << "Warning: " << frameRing.error() << endl;
+                    shmOutput.clear();
+                }
+            }
+            frameRing.publish(*published, frameIndex);
         }
-        else if (key == '2') {
-            currentTool = ERASER;
-            cout << "Tool: Eraser" << endl;
+        if (mjpegServer.isRunning()) {
+            mjpegServer.submit(output);
         }
-        else if (key == '3') {
-            currentTool = LINE;
-            cout << "Tool: Line" << endl;
+        
+        if (hudVisible) {
+            drawCanvasBounds(output);
         }
-        else if (key == '4') {
-            currentTool = RECTANGLE;
-            cout << "Tool: Rectangle" << endl;
+        
+        if (showColorPalette && hudVisible) {
+            drawColorPalette(output);
         }
-        else if (key == '5') {
-            currentTool = CIRCLE;
-            cout << "Tool: Circle" << endl;
+        
+        if (showHelp && hudVisible) {
+            drawHelpText(output);
         }
-        else if (key == '6') {
-            currentTool = ELLIPSE;
-            cout << "Tool: Ellipse" << endl;
+        
+        if (showStats) {
+            fpsCounter.drawOverlay(output, Point(10, output.rows - 70));
+            framePacer.drawOverlay(output, Point(10, output.rows - 15));
+            latencyTracker.drawOverlay(output, Point(10, output.rows - 100));
+            MemoryAccountant::drawOverlay(output, Point(10, output.rows - 125));
+            if (stabilize) {
+                motionTracker.drawOverlay(output, Point(10, output.rows - 150));
+            }
+            allocationMonitor.drawOverlay(output, Point(10, output.rows - 175));
+            if (mjpegServer.isRunning()) {
+                mjpegServer.drawOverlay(output, Point(10, output.rows - 200));
+            }
+            if (chromaKey.enabled()) {
+                chromaKey.drawOverlay(output, Point(10, output.rows - 225));
+            }
+            if (engine.indexed()) {
+                engine.palette().drawOverlay(output, Point(10, output.rows - 250));
+            }
+        }
+        allocationMonitor.endFrame();
+        
+        if (headless) {
+            latencyTracker.markDisplayed();
+            framePacer.endFrame();
+            if (syncEnabled) {
+                syncPeer.flush();
+            }
+            continue;
+        }
+        
+        if (previewScale != 1.0) {
+            {
+                performance::ScopedMemoryTag tag(MemoryTag::Preview);
+                resize(output, preview, Size(), previewScale, previewScale, INTER_AREA);
+            }
+            imshow(windowName, preview);
+        } else {
+            imshow(windowName, output);
         }
-        else if (key == '7') {
-            currentTool = SPRAY;
-            cout << "Tool: Spray Paint" << endl;
+        latencyTracker.markDisplayed();
+        
+        // Sleep until the frame deadline instead of spinning on waitKey(1)
+        int key = waitKey(framePacer.endFrame());
+        
+        // A label being edited takes all typing, including shortcut keys
+        if (key >= 0 && textLabels.handleKey(key & 0xFF)) {
+            key = -1;
         }
-        else if (key == '8') {
-            currentTool = FILL;
-            cout << "Tool: Fill" << endl;
+        key &= 0xFF;
+        
+        // Tool selection
+        int toolId = engine.tools().findByKey(key);
+        if (toolId >= 0) {
+            selectTool(toolId);
         }
         // Actions
         else if (key == 'c' || key == 'C') {
-            saveState();
-            doodleLayer = Mat::zeros(frame.size(), CV_8UC3);
+            cancelStroke();
+            applyStrokeOp(collab::StrokeOpType::Clear, 0, 0);
             cout << "Drawing cleared" << endl;
         }
         else if (key == 'z' || key == 'Z') {
@@ -406,6 +1015,9 @@ int main() {
         else if (key == 's' || key == 'S') {
             saveDrawing();
         }
+        else if (key == 'w' || key == 'W') {
+            saveProject();
+        }
         else if (key == 'h' || key == 'H') {
             showHelp = !showHelp;
             cout << (showHelp ? "Help enabled" : "Help disabled") << endl;
@@ -414,14 +1026,48 @@ int main() {
             showColorPalette = !showColorPalette;
             cout << (showColorPalette ? "Palette enabled" : "Palette disabled") << endl;
         }
+        else if (key == 'k' || key == 'K') {
+            if (chromaKey.settings().mode == doodle::ChromaKey::Mode::Off) {
+                cout << "Chroma key not configured (--chroma-key)" << endl;
+            } else {
+                chromaKey.setEnabled(!chromaKey.enabled());
+                cout << (chromaKey.enabled() ? "Chroma key enabled" : "Chroma key disabled")
+                     << endl;
+            }
+        }
+        else if (key == 'b' || key == 'B') {
+            if (chromaKey.settings().mode == doodle::ChromaKey::Mode::Background) {
+                chromaKey.learnBackground();
+                cout << "Learning background, step out of the picture" << endl;
+            }
+        }
+        else if (key == 'f' || key == 'F') {
+            showStats = !showStats;
+            cout << (showStats ? "Stats enabled" : "Stats disabled") << endl;
+        }
         else if (key == 27) {
             cout << endl << "Exiting program..." << endl;
             break;
         }
+        
+        // Send this frame's strokes as one batch
+        if (syncEnabled) {
+            syncPeer.flush();
+        }
     }
     
+    cout << endl;
+    latencyTracker.report(cout);
+    cout << "Frames with allocations: " << allocationMonitor.allocatingFrames() << " of "
+         << allocationMonitor.frames() << endl;
+    cout << endl;
+    
     // Cleanup
     cout << "Releasing resources..." << endl;
+    syncPeer.close();
+    frameRing.close();
+    mjpegServer.stop();
+    motionTracker.stop();
     camera.release();
     destroyAllWindows();
     cout << "Done. Goodbye!" << endl << endl;
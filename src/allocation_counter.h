@@ -0,0 +1,158 @@
+/**
+ * @file allocation_counter.h
+ * @brief Per-thread heap and Mat allocation counts, sampled per frame
+ * @author Chethana G
+ * @date 2026-10-19
+ *
+ * Two sources feed the counters: TrackingMatAllocator reports every Mat
+ * buffer, and the operator new replacements in allocation_hooks.h report
+ * every other heap allocation. The hooks are optional; without them only
+ * Mat buffers are counted.
+ *
+ * Counts are kept per thread, so the frame loop is not charged for the
+ * allocations of worker threads.
+ */
+
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <opencv2/opencv.hpp>
+#include "overlay_text.h"
+
+namespace performance {
+
+/**
+ * @struct AllocationCounts
+ * @brief Allocation totals of one thread
+ */
+struct AllocationCounts {
+    uint64_t heap = 0;       ///< operator new calls (only with the hooks)
+    uint64_t heapBytes = 0;
+    uint64_t mats = 0;       ///< Mat buffers from TrackingMatAllocator
+    uint64_t matBytes = 0;
+
+    uint64_t total() const { return heap + mats; }
+
+    AllocationCounts operator-(const AllocationCounts& other) const {
+        AllocationCounts d;
+        d.heap = heap - other.heap;
+        d.heapBytes = heapBytes - other.heapBytes;
+        d.mats = mats - other.mats;
+        d.matBytes = matBytes - other.matBytes;
+        return d;
+    }
+};
+
+/**
+ * @class AllocationCounter
+ * @brief Entry points for the allocation hooks
+ */
+class AllocationCounter {
+public:
+    static void countHeap(size_t bytes) {
+        AllocationCounts& counts = current();
+        counts.heap++;
+        counts.heapBytes += bytes;
+        if (!heapHooked_.load(std::memory_order_relaxed)) {
+            heapHooked_.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    static void countMat(size_t bytes) {
+        AllocationCounts& counts = current();
+        counts.mats++;
+        counts.matBytes += bytes;
+    }
+
+    /**
+     * @brief Totals of the calling thread since it started
+     */
+    static AllocationCounts thisThread() { return current(); }
+
+    /**
+     * @brief True once the operator new hooks have seen an allocation
+     */
+    static bool heapHooked() { return heapHooked_.load(std::memory_order_relaxed); }
+
+private:
+    static AllocationCounts& current() {
+        // Constant-initialized, so touching it never allocates
+        thread_local AllocationCounts counts;
+        return counts;
+    }
+
+    static inline std::atomic<bool> heapHooked_{false};
+};
+
+/**
+ * @class FrameAllocationMonitor
+ * @brief Allocations made by the frame loop, frame by frame
+ */
+class FrameAllocationMonitor {
+public:
+    FrameAllocationMonitor() : frames_(0), allocatingFrames_(0) {}
+
+    /**
+     * @brief Start counting a frame on the calling thread
+     */
+    void beginFrame() { start_ = AllocationCounter::thisThread(); }
+
+    /**
+     * @brief Stop counting the frame
+     * @return Allocations made since beginFrame()
+     */
+    AllocationCounts endFrame() {
+        last_ = AllocationCounter::thisThread() - start_;
+        frames_++;
+        if (last_.total() > 0) {
+            allocatingFrames_++;
+        }
+        return last_;
+    }
+
+    const AllocationCounts& lastFrame() const { return last_; }
+    uint64_t frames() const { return frames_; }
+    uint64_t allocatingFrames() const { return allocatingFrames_; }
+
+    /**
+     * @brief Forget all frames counted so far, e.g. after warm-up
+     */
+    void reset() {
+        frames_ = 0;
+        allocatingFrames_ = 0;
+        last_ = AllocationCounts();
+    }
+
+    /**
+     * @brief Draw the last frame's allocations on image
+     * @param img Target image
+     * @param position Text position
+     */
+    void drawOverlay(cv::Mat& img, cv::Point position = cv::Point(10, 240)) const {
+        char text[96];
+        if (AllocationCounter::heapHooked()) {
+            std::snprintf(text, sizeof(text), "Allocs/frame: heap %llu mat %llu | dirty %llu",
+                          static_cast<unsigned long long>(last_.heap),
+                          static_cast<unsigned long long>(last_.mats),
+                          static_cast<unsigned long long>(allocatingFrames_));
+        } else {
+            std::snprintf(text, sizeof(text), "Allocs/frame: mat %llu | dirty %llu",
+                          static_cast<unsigned long long>(last_.mats),
+                          static_cast<unsigned long long>(allocatingFrames_));
+        }
+        drawOverlayText(img, text, position, 0.5, cv::Scalar(255, 255, 0), 1);
+    }
+
+private:
+    AllocationCounts start_;
+    AllocationCounts last_;
+    uint64_t frames_;
+    uint64_t allocatingFrames_;
+};
+
+}  // namespace performance
+
+#endif  // ALLOCATION_COUNTER_H
@@ -0,0 +1,102 @@
+/**
+ * @file allocation_hooks.h
+ * @brief Global operator new/delete replacements that feed AllocationCounter
+ * @author Chethana G
+ * @date 2026-10-19
+ *
+ * Replacement allocation functions must be defined once per program, so
+ * include this header in exactly one translation unit (the one with main()).
+ * Allocation goes straight to malloc/free; the only extra cost is a
+ * thread-local increment.
+ */
+
+#ifndef ALLOCATION_HOOKS_H
+#define ALLOCATION_HOOKS_H
+
+#include <cstdlib>
+#include <new>
+#include "allocation_counter.h"
+
+namespace performance {
+namespace alloc_detail {
+
+inline void* allocate(std::size_t size) {
+    AllocationCounter::countHeap(size);
+    return std::malloc(size ? size : 1);
+}
+
+inline void* allocateAligned(std::size_t size, std::align_val_t align) {
+    AllocationCounter::countHeap(size);
+    std::size_t alignment = static_cast<std::size_t>(align);
+#ifdef _WIN32
+    return _aligned_malloc(size ? size : 1, alignment);
+#else
+    // aligned_alloc needs a multiple of the alignment
+    std::size_t rounded = ((size ? size : 1) + alignment - 1) / alignment * alignment;
+    return std::aligned_alloc(alignment, rounded);
+#endif
+}
+
+inline void freeAligned(void* p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+}  // namespace alloc_detail
+}  // namespace performance
+
+void* operator new(std::size_t size) {
+    if (void* p = performance::alloc_detail::allocate(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    if (void* p = performance::alloc_detail::allocate(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return performance::alloc_detail::allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return performance::alloc_detail::allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+    if (void* p = performance::alloc_detail::allocateAligned(size, align)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t align) {
+    if (void* p = performance::alloc_detail::allocateAligned(size, align)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    performance::alloc_detail::freeAligned(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+    performance::alloc_detail::freeAligned(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    performance::alloc_detail::freeAligned(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+    performance::alloc_detail::freeAligned(p);
+}
+
+#endif  // ALLOCATION_HOOKS_H
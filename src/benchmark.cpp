@@ -5,10 +5,28 @@
  * @date 2025-12-27
  */
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <vector>
 #include <opencv2/opencv.hpp>
+#include "allocation_hooks.h"
+#include "chroma_key.h"
+#include "compositor.h"
+#include "doodle_engine.h"
+#include "frame_pacer.h"
+#include "frame_pool.h"
+#include "glyph_atlas.h"
+#include "latency_tracker.h"
+#include "memory_accounting.h"
 #include "performance_monitor.h"
+#include "project_file.h"
+#include "stroke_sync.h"
+#include "tools.h"
 
 using namespace cv;
 using namespace performance;
@@ -113,10 +131,819 @@ void benchmarkFPSCounter() {
               << "us\n" << std::endl;
 }
 
+/**
+ * @brief Benchmark text rendering: cv::putText against the glyph atlas
+ */
+void benchmarkTextRendering() {
+    std::cout << "\n=== Text Rendering Benchmark ===\n" << std::endl;
+    
+    Mat canvas(480, 640, CV_8UC3, Scalar(0, 0, 0));
+    PerformanceTimer timer;
+    const int iterations = 1000;
+    const std::string text = "Left Click & Drag: Draw";
+    
+    timer.start();
+    for (int i = 0; i < iterations; i++) {
+        putText(canvas, text, Point(20, 145), FONT_HERSHEY_SIMPLEX, 0.45,
+                Scalar(255, 255, 255), 1, LINE_AA);
+    }
+    double putTextTime = timer.stop();
+    std::cout << "putText: " << putTextTime << "ms ("
+              << iterations << " iterations)" << std::endl;
+    std::cout << "Average: " << putTextTime / iterations << "ms per label\n" << std::endl;
+    
+    doodle::GlyphAtlas atlas;
+    timer.start();
+    for (int i = 0; i < iterations; i++) {
+        atlas.drawText(canvas, text, Point(20, 145), FONT_HERSHEY_SIMPLEX, 0.45,
+                       Scalar(255, 255, 255), 1);
+    }
+    double atlasTime = timer.stop();
+    std::cout << "Glyph atlas: " << atlasTime << "ms ("
+              << iterations << " iterations, " << atlas.glyphCount()
+              << " glyphs cached)" << std::endl;
+    std::cout << "Average: " << atlasTime / iterations << "ms per label\n" << std::endl;
+}
+
+doodle::GlyphAtlas* overlayAtlas = nullptr;
+
+void drawOverlayWithAtlas(Mat& img, const char* text, Point org, double fontScale,
+                          const Scalar& color, int thickness) {
+    overlayAtlas->drawText(img, text, org, FONT_HERSHEY_SIMPLEX, fontScale, color, thickness);
+}
+
+// One stroke: Begin, a run of Moves and optionally End
+std::vector<collab::StrokeOp> makeStroke(uint8_t tool, uint8_t size, uint32_t seed, Point from,
+                                         Point step, int moves, bool end) {
+    std::vector<collab::StrokeOp> ops;
+    collab::StrokeOp op;
+    op.type = collab::StrokeOpType::Begin;
+    op.tool = tool;
+    op.size = size;
+    op.color[0] = static_cast<uint8_t>(seed * 31);
+    op.color[1] = 200;
+    op.color[2] = static_cast<uint8_t>(255 - size);
+    op.seed = seed;
+    op.x = from.x;
+    op.y = from.y;
+    ops.push_back(op);
+    for (int m = 0; m < moves; m++) {
+        op.type = collab::StrokeOpType::Move;
+        op.x += step.x;
+        op.y += step.y + (m % 3) - 1;
+        ops.push_back(op);
+    }
+    if (end) {
+        op.type = collab::StrokeOpType::End;
+        ops.push_back(op);
+    }
+    return ops;
+}
+
+bool sameOps(const std::vector<collab::StrokeOp>& a, const std::vector<collab::StrokeOp>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].type != b[i].type || a[i].x != b[i].x || a[i].y != b[i].y) return false;
+        if (a[i].type == collab::StrokeOpType::Begin &&
+            (a[i].tool != b[i].tool || a[i].size != b[i].size || a[i].seed != b[i].seed ||
+             std::memcmp(a[i].color, b[i].color, 3) != 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Apply the batches a peer polled, its own through the local path
+ */
+void applyBatches(doodle::DoodleEngine& engine, const collab::StrokeSyncPeer& peer,
+                  const std::vector<collab::StrokeBatch>& batches) {
+    for (const collab::StrokeBatch& batch : batches) {
+        if (batch.instanceId == peer.instanceId()) {
+            engine.apply(batch.ops.data(), batch.ops.size());
+        } else {
+            engine.applyRemote(batch);
+        }
+    }
+}
+
+/**
+ * @brief Round-trip stroke batches through loopback peers
+ *
+ * Two peers send to a host over socket pairs: encode, send, poll and apply.
+ * The host must decode every batch intact, order them by (Lamport clock,
+ * instance id), relay them to the other peer and render the same canvas as
+ * applying the original batches in that order. Then two peers draw crossing
+ * strokes over several frames, each applying its own batches through poll()
+ * as well, and must end up with identical canvases.
+ * @return False if the check failed
+ */
+bool checkStrokeSync() {
+    std::cout << "\n=== Stroke Sync Loopback ===\n" << std::endl;
+#ifdef _WIN32
+    std::cout << "Skipped: stroke sync is not supported on Windows" << std::endl;
+    return true;
+#else
+    collab::StrokeSyncPeer host(1), first(7), second(3);
+    if (!collab::StrokeSyncPeer::connectLoopback(host, first) ||
+        !collab::StrokeSyncPeer::connectLoopback(host, second)) {
+        std::cerr << "FAILED: " << host.error() << first.error() << second.error() << std::endl;
+        return false;
+    }
+    
+    // first sends two frames (one stroke split across them), second one frame;
+    // the host reads first's connection first, so ordering has to fix it up
+    std::vector<collab::StrokeOp> brush =
+        makeStroke(0, 4, 0, Point(600, 20), Point(-9, 6), 40, true);
+    std::vector<collab::StrokeBatch> sent(3);
+    sent[1].instanceId = 7;
+    sent[1].clock = 1;
+    sent[1].ops.assign(brush.begin(), brush.begin() + 20);
+    sent[2].instanceId = 7;
+    sent[2].clock = 2;
+    sent[2].ops.assign(brush.begin() + 20, brush.end());
+    sent[0].instanceId = 3;
+    sent[0].clock = 1;
+    sent[0].ops = makeStroke(6, 5, 12345, Point(100, 400), Point(7, -5), 30, true);
+    collab::StrokeOp clear;
+    clear.type = collab::StrokeOpType::Clear;
+    sent[0].ops.insert(sent[0].ops.begin(), clear);
+    
+    for (int i : {1, 0, 2}) {
+        collab::StrokeSyncPeer& peer = sent[i].instanceId == 7 ? first : second;
+        for (const collab::StrokeOp& op : sent[i].ops) {
+            peer.record(op);
+        }
+        peer.flush();
+    }
+    
+    // second gets first's batches relayed and its own back from poll()
+    std::vector<collab::StrokeBatch> received, relayed;
+    host.poll(received);
+    second.poll(relayed);
+    bool ok = received.size() == sent.size() && relayed.size() == sent.size();
+    for (size_t i = 0; ok && i < sent.size(); i++) {
+        ok = received[i].instanceId == sent[i].instanceId &&
+             received[i].clock == sent[i].clock && sameOps(received[i].ops, sent[i].ops) &&
+             relayed[i].instanceId == sent[i].instanceId && relayed[i].clock == sent[i].clock;
+    }
+    ok = ok && host.clock() > 2;
+    
+    doodle::DoodleEngine viaSync, direct;
+    viaSync.reset(Size(640, 480));
+    direct.reset(Size(640, 480));
+    for (size_t i = 0; ok && i < sent.size(); i++) {
+        viaSync.applyRemote(received[i]);
+        direct.applyRemote(sent[i]);
+    }
+    ok = ok && norm(viaSync.canvas(), direct.canvas(), NORM_INF) == 0 &&
+         countNonZero(direct.canvas().reshape(1)) > 0;
+    
+    std::cout << "Batches: " << received.size() << " received, " << relayed.size()
+              << " polled by a peer, " << host.bytesReceived() << " bytes" << std::endl;
+    if (!ok) {
+        std::cerr << "FAILED: loopback batches do not round-trip" << std::endl;
+        return false;
+    }
+    
+    // Crossing strokes drawn over the same frames: each peer has its own
+    // batch in hand before the other's arrives, yet both must agree
+    collab::StrokeSyncPeer left(2), right(9);
+    if (!collab::StrokeSyncPeer::connectLoopback(left, right)) {
+        std::cerr << "FAILED: " << left.error() << right.error() << std::endl;
+        return false;
+    }
+    std::vector<collab::StrokeOp> across =
+        makeStroke(0, 12, 1, Point(100, 200), Point(8, 1), 40, true);
+    std::vector<collab::StrokeOp> down =
+        makeStroke(0, 12, 2, Point(260, 60), Point(1, 8), 40, true);
+    doodle::DoodleEngine leftCanvas, rightCanvas, reversed;
+    leftCanvas.reset(Size(640, 480));
+    rightCanvas.reset(Size(640, 480));
+    reversed.reset(Size(640, 480));
+    std::vector<collab::StrokeBatch> batches;
+    const size_t perFrame = 10;
+    for (size_t begin = 0; begin < across.size(); begin += perFrame) {
+        size_t end = std::min(begin + perFrame, across.size());
+        for (size_t i = begin; i < end; i++) {
+            left.record(across[i]);
+            right.record(down[i]);
+        }
+        left.flush();
+        right.flush();
+        left.poll(batches);
+        applyBatches(leftCanvas, left, batches);
+        right.poll(batches);
+        applyBatches(rightCanvas, right, batches);
+        // The order right would use if it drew its own operations right away
+        reversed.applyRemote(9, down.data() + begin, end - begin);
+        reversed.applyRemote(2, across.data() + begin, end - begin);
+    }
+    
+    double difference = norm(leftCanvas.canvas(), rightCanvas.canvas(), NORM_INF);
+    bool overlapping = norm(leftCanvas.canvas(), reversed.canvas(), NORM_INF) > 0;
+    std::cout << "Crossing strokes: canvases differ by " << difference << " ("
+              << (overlapping ? "order matters" : "order does not matter") << ")" << std::endl;
+    if (difference != 0 || !overlapping || countNonZero(leftCanvas.canvas().reshape(1)) == 0) {
+        std::cerr << "FAILED: peers drawing crossing strokes do not converge" << std::endl;
+        return false;
+    }
+    return true;
+#endif
+}
+
+// Draw the same strokes into a fresh engine, local ones first
+Mat drawnAlone(Size size, int type, const std::vector<collab::StrokeOp>& local,
+               const std::vector<collab::StrokeOp>& remote) {
+    doodle::DoodleEngine engine;
+    engine.setLineType(LINE_8);
+    engine.reset(size, type);
+    if (!local.empty()) engine.apply(local.data(), local.size());
+    if (!remote.empty()) engine.applyRemote(5, remote.data(), remote.size());
+    Mat bgr;
+    engine.render(bgr);
+    return bgr;
+}
+
+/**
+ * @brief Check that a local and a remote stroke over each other stay independent
+ *
+ * Undoing a local stroke that a remote stroke crosses must leave the remote
+ * stroke whole, and redo must bring back the same picture as before. A peer
+ * cancelling its stroke over the local stroke in progress must leave the
+ * local stroke whole, and cancelling the local stroke after the peer
+ * finished over it must leave the peer's. The strokes are drawn without
+ * anti-aliasing, so every pixel belongs to one of them and the results can
+ * be compared exactly with engines that drew only some of the strokes. Both
+ * canvas storages are checked.
+ * @return False if the check failed
+ */
+bool checkConcurrentStrokes() {
+    std::cout << "\n=== Concurrent Strokes ===\n" << std::endl;
+    
+    const Size size(320, 240);
+    std::vector<collab::StrokeOp> local =
+        makeStroke(0, 9, 0, Point(20, 120), Point(12, 0), 22, true);
+    std::vector<collab::StrokeOp> remote =
+        makeStroke(0, 7, 1, Point(150, 10), Point(0, 10), 21, true);
+    std::vector<collab::StrokeOp> localOpen(local.begin(), local.end() - 1);
+    std::vector<collab::StrokeOp> remoteOpen(remote.begin(), remote.end() - 1);
+    collab::StrokeOp cancel;
+    cancel.type = collab::StrokeOpType::Cancel;
+    bool ok = true;
+    for (int type : {CV_8UC3, CV_8UC1}) {
+        doodle::DoodleEngine engine;
+        engine.setLineType(LINE_8);
+        engine.reset(size, type);
+        engine.apply(local.data(), local.size());
+        engine.applyRemote(5, remote.data(), remote.size());
+        Mat bgr;
+        
+        bool undone = engine.undo();
+        engine.render(bgr);
+        bool keeps = undone && norm(bgr, drawnAlone(size, type, {}, remote), NORM_INF) == 0;
+        bool redone = engine.redo();
+        engine.render(bgr);
+        bool restores = redone && norm(bgr, drawnAlone(size, type, local, remote), NORM_INF) == 0;
+        
+        engine.reset(size, type);
+        engine.apply(localOpen.data(), localOpen.size());
+        engine.applyRemote(5, remoteOpen.data(), remoteOpen.size());
+        engine.applyRemote(5, &cancel, 1);
+        engine.render(bgr);
+        bool remoteCancel = norm(bgr, drawnAlone(size, type, localOpen, {}), NORM_INF) == 0;
+        
+        engine.reset(size, type);
+        engine.apply(localOpen.data(), localOpen.size());
+        engine.applyRemote(5, remote.data(), remote.size());
+        engine.apply(cancel);
+        engine.render(bgr);
+        bool localCancel = norm(bgr, drawnAlone(size, type, {}, remote), NORM_INF) == 0;
+        
+        std::cout << (type == CV_8UC3 ? "BGR:     " : "Indexed: ")
+                  << "undo keeps the remote stroke " << (keeps ? "OK" : "FAILED")
+                  << ", redo restores " << (restores ? "OK" : "FAILED")
+                  << ", remote cancel " << (remoteCancel ? "OK" : "FAILED")
+                  << ", local cancel " << (localCancel ? "OK" : "FAILED") << std::endl;
+        ok = ok && keeps && restores && remoteCancel && localCancel;
+    }
+    std::cout << std::endl;
+    if (!ok) {
+        std::cerr << "FAILED: local and remote strokes interfere" << std::endl;
+    }
+    return ok;
+}
+
+std::vector<char> readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const std::vector<char>& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+uint64_t readLE(const std::vector<char>& bytes, size_t at, int size) {
+    uint64_t v = 0;
+    for (int i = 0; i < size; i++) v |= static_cast<uint64_t>(uchar(bytes[at + i])) << (8 * i);
+    return v;
+}
+
+void writeLE(std::vector<char>& bytes, size_t at, uint64_t v, int size) {
+    for (int i = 0; i < size; i++) bytes[at + i] = static_cast<char>(v >> (8 * i));
+}
+
+/**
+ * @brief Save, reopen, resave and damage a project file
+ *
+ * A canvas with undo and redo levels and a label must reopen identically.
+ * Saving the reopened project unchanged may append nothing but a new index.
+ * A copy with a second layer must survive a save under another name, and
+ * truncated or corrupt copies must be refused instead of read.
+ * @return False if the check failed
+ */
+bool checkProjectFile() {
+    std::cout << "\n=== Project File Round Trip ===\n" << std::endl;
+    const std::string path = "benchmark_check.ldp";
+    const std::string other = "benchmark_check_copy.ldp";
+    
+    Mat canvas(300, 420, CV_8UC3, Scalar::all(0));
+    doodle::History history;
+    history.reset(canvas);
+    line(canvas, Point(10, 20), Point(400, 280), Scalar(0, 200, 255), 5);
+    history.record(canvas, Rect(5, 15, 401, 271));
+    circle(canvas, Point(300, 80), 40, Scalar(255, 0, 0), -1);
+    history.record(canvas, Rect(260, 40, 81, 81));
+    rectangle(canvas, Point(20, 200), Point(140, 260), Scalar(40, 255, 40), 3);
+    history.record(canvas, Rect(18, 198, 125, 65));
+    Rect damage;
+    history.undo(canvas, damage);
+    doodle::TextLabel label;
+    label.text = "round trip";
+    label.origin = Point(30, 60);
+    label.color = Scalar(255, 255, 255);
+    
+    bool ok;
+    {
+        doodle::ProjectFile saved;
+        ok = saved.save(path, canvas, &history, {label});
+    }
+    
+    // Reopen: pixels, levels and labels come back
+    doodle::ProjectFile project;
+    ok = ok && project.open(path);
+    Mat loaded(canvas.size(), canvas.type());
+    std::deque<doodle::History::Patch> undo, redo;
+    std::vector<Rect> decoded;
+    ok = ok && project.loadTiles(loaded, Rect(Point(), loaded.size()), decoded) > 0 &&
+         project.fullyLoaded() && norm(loaded, canvas, NORM_INF) == 0 &&
+         project.loadHistory(undo, redo) && undo.size() == 2 && redo.size() == 1 &&
+         project.labels().size() == 1 && project.labels()[0].text == label.text;
+    for (size_t i = 0; ok && i < undo.size(); i++) {
+        ok = undo[i].rect == history.undoPatches()[i].rect &&
+             norm(undo[i].pixels, history.undoPatches()[i].pixels, NORM_INF) == 0;
+    }
+    
+    // Unchanged resave: only the index is new, and it replaces the old one
+    doodle::History reopened;
+    reopened.reset(loaded);
+    ok = ok && reopened.restore(std::move(undo), std::move(redo)) == 0;
+    uint64_t before = readFile(path).size();
+    uint64_t garbage = project.garbageBytes();
+    ok = ok && project.save(path, loaded, &reopened, project.labels());
+    uint64_t grown = readFile(path).size() - before;
+    ok = ok && project.garbageBytes() - garbage == grown;
+    std::cout << "Unchanged resave appended " << grown << " bytes" << std::endl;
+    
+    // Undo after reopening, then save incrementally and reopen again
+    ok = ok && reopened.undo(loaded, damage);
+    project.markDirty(damage);
+    ok = ok && project.save(path, loaded, &reopened, project.labels());
+    doodle::ProjectFile again;
+    Mat reloaded(canvas.size(), canvas.type());
+    ok = ok && again.open(path) && again.loadTiles(reloaded, Rect(Point(), canvas.size()),
+                                                   decoded) > 0 &&
+         norm(reloaded, loaded, NORM_INF) == 0 && again.loadHistory(undo, redo) &&
+         undo.size() == 1 && redo.size() == 2;
+    again.close();
+    project.close();
+    
+    // Give a copy a second layer that shares the first layer's tiles
+    std::vector<char> bytes = readFile(path);
+    size_t indexOffset = readLE(bytes, 32, 8);
+    size_t indexSize = readLE(bytes, 40, 8);
+    uint64_t tiles = readLE(bytes, indexOffset, 4);
+    std::vector<char> index(bytes.begin() + indexOffset, bytes.begin() + indexOffset + indexSize);
+    std::vector<char> entries(index.begin() + 4, index.begin() + 4 + tiles * 12);
+    index.insert(index.begin() + 4 + tiles * 12, entries.begin(), entries.end());
+    writeLE(index, 0, tiles * 2, 4);
+    writeLE(bytes, 28, 2, 4);
+    writeLE(bytes, 32, bytes.size(), 8);
+    writeLE(bytes, 40, index.size(), 8);
+    bytes.insert(bytes.end(), index.begin(), index.end());
+    writeFile(other, bytes);
+    Mat layer(canvas.size(), canvas.type());
+    {
+        doodle::ProjectFile layered;
+        ok = ok && layered.open(other) && layered.layerCount() == 2 &&
+             layered.save(path, reloaded, nullptr, {}) && layered.open(path) &&
+             layered.layerCount() == 2 &&
+             layered.loadTiles(layer, Rect(Point(), canvas.size()), decoded, 1) > 0 &&
+             norm(layer, reloaded, NORM_INF) == 0;
+    }
+    
+    // Damaged copies: truncated, bad magic, index past the end
+    bytes = readFile(path);
+    int refused = 0;
+    for (int damaged = 0; damaged < 3; damaged++) {
+        std::vector<char> copy = bytes;
+        if (damaged == 0) copy.resize(copy.size() / 2);
+        if (damaged == 1) copy[0] = 'X';
+        if (damaged == 2) writeLE(copy, 32, copy.size() + 64, 8);
+        writeFile(other, copy);
+        doodle::ProjectFile broken;
+        if (!broken.open(other)) refused++;
+    }
+    ok = ok && refused == 3;
+    std::remove(path.c_str());
+    std::remove(other.c_str());
+    
+    std::cout << "Round trip, layered save and " << refused << "/3 damaged files refused: "
+              << (ok ? "OK" : "FAILED") << std::endl;
+    if (!ok) {
+        std::cerr << "FAILED: project file does not round-trip" << std::endl;
+    }
+    return ok;
+}
+
+/**
+ * @brief Run the frame loop's steady state and count its allocations
+ *
+ * Mirrors one iteration of the application: new camera frame, a brush
+ * stroke segment, compositing into a pooled buffer with and without a scene
+ * transform, and the HUD text. Committing a stroke to history is an event
+ * rather than part of the steady state and is not measured here.
+ * @return Number of measured frames that allocated
+ */
+uint64_t benchmarkSteadyStateAllocations() {
+    std::cout << "\n=== Steady-State Allocations ===\n" << std::endl;
+    
+    Mat cameraFrames[2] = {Mat(480, 640, CV_8UC3), Mat(480, 640, CV_8UC3)};
+    randu(cameraFrames[0], Scalar::all(0), Scalar::all(255));
+    randu(cameraFrames[1], Scalar::all(0), Scalar::all(255));
+    Mat frame, canvas(480, 640, CV_8UC3, Scalar::all(0)), output;
+    
+    doodle::GlyphAtlas atlas;
+    overlayAtlas = &atlas;
+    overlayTextRenderer() = drawOverlayWithAtlas;
+    
+    doodle::BrushTool brush;
+    doodle::ToolContext ctx;
+    ctx.canvas = &canvas;
+    doodle::Compositor compositor;
+    FramePool outputPool;
+    FPSCounter fpsCounter;
+    FramePacer framePacer;
+    LatencyTracker latencyTracker;
+    FrameAllocationMonitor monitor;
+    
+    const int warmupFrames = 200;
+    const int measuredFrames = 600;
+    Rect strokeDamage;
+    for (int i = 0; i < warmupFrames + measuredFrames; i++) {
+        if (i == warmupFrames) {
+            monitor.reset();
+        }
+        monitor.beginFrame();
+        
+        cameraFrames[i % 2].copyTo(frame);
+        latencyTracker.markCapture();
+        framePacer.beginFrame();
+        fpsCounter.update();
+        
+        // A new stroke every 8 frames
+        Point p(40 + (i * 37) % 560, 40 + (i * 23) % 400);
+        if (i % 8 == 0) {
+            brush.begin(ctx, p);
+            strokeDamage = Rect();
+        }
+        strokeDamage = doodle::unite(strokeDamage, brush.update(ctx, p));
+        compositor.addDamage(strokeDamage);
+        if (i % 8 == 7) {
+            brush.commit(ctx, p);
+        }
+        
+        // Alternate between plain and scene-anchored compositing
+        if ((i / 100) % 2) {
+            compositor.setTransform(Matx33d(1, 0.02, 5, -0.02, 1, 3, 0, 0, 1));
+        } else {
+            compositor.clearTransform();
+        }
+        output = outputPool.acquire(frame.size(), frame.type());
+        compositor.composite(frame, canvas, output);
+        latencyTracker.markComposited();
+        
+        char info[64];
+        std::snprintf(info, sizeof(info), "Tool: %s | Size: %dpx", brush.name(), ctx.size);
+        atlas.drawText(output, "ADVANCED CONTROLS:", Point(20, 90), FONT_HERSHEY_SIMPLEX, 0.5,
+                       Scalar(255, 255, 255), 2);
+        atlas.drawText(output, info, Point(20, 385), FONT_HERSHEY_SIMPLEX, 0.45,
+                       Scalar(0, 255, 0), 1);
+        fpsCounter.drawOverlay(output, Point(10, output.rows - 70));
+        framePacer.drawOverlay(output, Point(10, output.rows - 15));
+        latencyTracker.drawOverlay(output, Point(10, output.rows - 100));
+        MemoryAccountant::drawOverlay(output, Point(10, output.rows - 125));
+        monitor.drawOverlay(output, Point(10, output.rows - 175));
+        latencyTracker.markDisplayed();
+        
+        AllocationCounts counts = monitor.endFrame();
+        if (i >= warmupFrames && counts.total() > 0 && monitor.allocatingFrames() <= 5) {
+            std::cout << "Frame " << i << ": " << counts.heap << " heap ("
+                      << counts.heapBytes << " bytes), " << counts.mats << " Mat ("
+                      << counts.matBytes << " bytes)" << std::endl;
+        }
+    }
+    overlayTextRenderer() = nullptr;
+    
+    std::cout << "Frames measured: " << monitor.frames() << " (after " << warmupFrames
+              << " warm-up frames)" << std::endl;
+    std::cout << "Frames with allocations: " << monitor.allocatingFrames() << "\n" << std::endl;
+    return monitor.allocatingFrames();
+}
+
+/**
+ * @brief Benchmark the engine's batch entry point against one call per operation
+ *
+ * Both runs apply the same remote strokes (so no undo levels pile up) to a
+ * fresh engine and count how often damage is reported.
+ */
+void benchmarkBatchRendering() {
+    std::cout << "\n=== Batch Rendering Benchmark ===\n" << std::endl;
+    
+    const int strokes = 500;
+    const int movesPerStroke = 32;
+    std::vector<collab::StrokeOp> ops;
+    ops.reserve(strokes * (movesPerStroke + 2));
+    for (int s = 0; s < strokes; s++) {
+        collab::StrokeOp op;
+        op.type = collab::StrokeOpType::Begin;
+        op.tool = 0;
+        op.size = static_cast<uint8_t>(2 + s % 6);
+        op.color[s % 3] = 255;
+        op.x = 20 + (s * 37) % 600;
+        op.y = 20 + (s * 23) % 440;
+        ops.push_back(op);
+        for (int m = 0; m < movesPerStroke; m++) {
+            op.type = collab::StrokeOpType::Move;
+            op.x = 20 + (op.x - 20 + 7) % 600;
+            op.y = 20 + (op.y - 20 + ((m % 4) - 1) * 3 + 440) % 440;
+            ops.push_back(op);
+        }
+        op.type = collab::StrokeOpType::End;
+        ops.push_back(op);
+    }
+    
+    PerformanceTimer timer;
+    for (int batched = 0; batched < 2; batched++) {
+        doodle::DoodleEngine engine;
+        engine.reset(Size(640, 480));
+        size_t reports = 0;
+        engine.onDamage([&reports](const Rect&) { reports++; });
+        
+        timer.start();
+        if (batched) {
+            engine.applyRemote(1, ops.data(), ops.size());
+        } else {
+            for (const collab::StrokeOp& op : ops) {
+                engine.applyRemote(1, &op, 1);
+            }
+        }
+        double elapsed = timer.stop();
+        std::cout << (batched ? "One batch:       " : "One call per op: ") << elapsed << "ms for "
+                  << ops.size() << " ops (" << elapsed * 1000.0 / ops.size() << "us per op, "
+                  << reports << " damage reports)" << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+/**
+ * @brief Compare BGR and palette-indexed canvas storage
+ *
+ * Draws the same local strokes into both kinds of canvas and reports the
+ * memory charged to the canvas, history and previews, then times clears,
+ * undo and compositing. The script uses 15 colors, so the palette never
+ * remaps, and the two composites must agree within coverage rounding.
+ * @return False if the composites differ
+ */
+bool benchmarkCanvasStorage() {
+    std::cout << "\n=== Canvas Storage Benchmark ===\n" << std::endl;
+    
+    const Size size(1280, 720);
+    const MemoryTag tags[] = {MemoryTag::Canvas, MemoryTag::History, MemoryTag::Preview};
+    const int iterations = 100;
+    Mat frame(size, CV_8UC3, Scalar(60, 60, 60)), output;
+    Mat composited[2];
+    uint64_t remapped = 0;
+    
+    PerformanceTimer timer;
+    for (int indexed = 0; indexed < 2; indexed++) {
+        int64_t before = 0;
+        for (MemoryTag tag : tags) before += MemoryAccountant::bytes(tag);
+        
+        doodle::DoodleEngine engine;
+        engine.history().setMaxDepth(20);
+        engine.reset(size, indexed ? CV_8UC1 : CV_8UC3);
+        for (int s = 0; s < 20; s++) {
+            collab::StrokeOp op;
+            op.type = collab::StrokeOpType::Begin;
+            op.tool = s % 4 == 3 ? 4 : 0;  // Every fourth stroke a circle
+            op.size = static_cast<uint8_t>(3 + s % 5);
+            op.color[s % 3] = 255;
+            op.color[(s + 1) % 3] = static_cast<uint8_t>((s % 5) * 60);
+            op.x = 40 + (s * 97) % 1200;
+            op.y = 40 + (s * 53) % 640;
+            engine.apply(op);
+            for (int m = 0; m < 64; m++) {
+                op.type = collab::StrokeOpType::Move;
+                op.x = 40 + (op.x - 40 + 11) % 1200;
+                op.y = 40 + (op.y - 40 + ((m % 8) - 3) * 4 + 640) % 640;
+                engine.apply(op);
+            }
+            op.type = collab::StrokeOpType::End;
+            engine.apply(op);
+        }
+        
+        int64_t bytes = -before;
+        for (MemoryTag tag : tags) bytes += MemoryAccountant::bytes(tag);
+        std::cout << (indexed ? "Indexed (8UC1): " : "BGR (8UC3):     ") << bytes / 1024
+                  << " KB canvas + history + previews" << std::endl;
+        
+        timer.start();
+        for (int i = 0; i < iterations; i++) {
+            engine.compositor().addDamage(Rect(Point(), size));
+            engine.composite(frame, output);
+        }
+        std::cout << "  Composite: " << timer.stop() / iterations << "ms per frame" << std::endl;
+        output.copyTo(composited[indexed]);
+        if (indexed) remapped = engine.palette().remapped();
+        
+        timer.start();
+        for (int i = 0; i < iterations; i++) {
+            engine.undo();
+            engine.redo();
+        }
+        std::cout << "  Undo+redo: " << timer.stop() / iterations << "ms" << std::endl;
+        
+        collab::StrokeOp clear;
+        clear.type = collab::StrokeOpType::Clear;
+        timer.start();
+        for (int i = 0; i < iterations; i++) {
+            engine.apply(clear);
+        }
+        std::cout << "  Clear:     " << timer.stop() / iterations << "ms (with undo level)"
+                  << std::endl;
+    }
+    
+    // Coverage is rounded to 15 steps, so a pixel may be off by half a step
+    // of the brightest channel (255 / 15 / 2). Larger differences are only
+    // expected on the anti-aliased edges where two colors cross, since the
+    // index keeps one color per pixel instead of blending.
+    const int tolerance = 9;
+    int64_t drawn = 0;
+    int64_t beyond = 0;
+    int worst = 0;
+    for (int y = 0; y < size.height; y++) {
+        const uchar* bgr = composited[0].ptr<uchar>(y);
+        const uchar* idx = composited[1].ptr<uchar>(y);
+        const uchar* cam = frame.ptr<uchar>(y);
+        for (int i = 0; i < size.width * 3; i += 3) {
+            if (std::memcmp(bgr + i, cam + i, 3) == 0 && std::memcmp(idx + i, cam + i, 3) == 0) {
+                continue;
+            }
+            drawn++;
+            int diff = 0;
+            for (int c = 0; c < 3; c++) diff = std::max(diff, std::abs(bgr[i + c] - idx[i + c]));
+            worst = std::max(worst, diff);
+            if (diff > tolerance) beyond++;
+        }
+    }
+    bool matches = remapped == 0 && drawn > 0 && beyond * 100 <= drawn;
+    std::cout << "BGR vs indexed: " << beyond << " of " << drawn << " drawn pixels differ by more "
+              << "than " << tolerance << " (max " << worst << "), " << remapped
+              << " colors remapped: " << (matches ? "OK" : "MISMATCH") << std::endl;
+    std::cout << std::endl;
+    return matches;
+}
+
+// A green-screen test frame: keyed green with noise, a subject with soft
+// edges, and a random strip so every span kind (kept, replaced, blended) occurs
+Mat makeKeyFrame(Size size, int seed) {
+    Mat frame(size, CV_8UC3, Scalar(40, 200, 50));
+    RNG rng(seed);
+    Mat noise(size, CV_8UC3);
+    rng.fill(noise, RNG::UNIFORM, Scalar::all(0), Scalar::all(24));
+    frame += noise;
+    ellipse(frame, Point(size.width / 2, size.height / 2), Size(size.width / 4, size.height / 3),
+            0, 0, 360, Scalar(90, 120, 200), FILLED, LINE_AA);
+    Rect strip(0, size.height / 4, size.width, std::max(size.height / 8, 1));
+    rng.fill(frame(strip), RNG::UNIFORM, Scalar::all(0), Scalar::all(256));
+    return frame;
+}
+
+// Key a frame with either loop; background mode learns from the first frame
+bool keyFrame(doodle::ChromaKey& key, doodle::ChromaKey::Mode mode, const Mat& background,
+              const Mat& frame, bool vectorized, Mat& output, Mat& alpha) {
+    doodle::ChromaKey::Settings settings;
+    settings.mode = mode;
+    settings.learnFrames = 1;
+    settings.replacement = doodle::ChromaKey::Replacement::Image;
+    key.configure(settings);
+    key.setVectorized(vectorized);
+    if (mode == doodle::ChromaKey::Mode::Background) key.process(background, output);
+    if (!key.process(frame, output)) return false;
+    key.alpha().copyTo(alpha);
+    return true;
+}
+
+/**
+ * @brief Time the chroma key at 1080p and compare its SSE2 and scalar loops
+ *
+ * Both key modes replace with an image, so the blend runs on real pixels.
+ * The comparison also uses widths that are not a multiple of 16 bytes, so
+ * the vector loops hand a tail to the scalar loop. Outputs and alpha must be
+ * identical.
+ * @return False if the two loops disagree
+ */
+bool benchmarkChromaKey() {
+    std::cout << "\n=== Chroma Key Benchmark ===\n" << std::endl;
+    
+    using Mode = doodle::ChromaKey::Mode;
+    const Mode modes[] = {Mode::Color, Mode::Background};
+    const int iterations = 30;
+    doodle::ChromaKey key;
+    Mat replacement(Size(320, 180), CV_8UC3);
+    randu(replacement, Scalar::all(0), Scalar::all(256));
+    key.setReplacementImage(replacement);
+    Mat output, alpha;
+    
+    const Size hd(1920, 1080);
+    Mat background = makeKeyFrame(hd, 1), frame = makeKeyFrame(hd, 2);
+    PerformanceTimer timer;
+    for (Mode mode : modes) {
+        for (int vectorized = doodle::ChromaKey::vectorizedBuild() ? 1 : 0; vectorized >= 0;
+             vectorized--) {
+            keyFrame(key, mode, background, frame, vectorized, output, alpha);
+            timer.start();
+            for (int i = 0; i < iterations; i++) {
+                key.process(frame, output);
+            }
+            std::cout << (mode == Mode::Color ? "Color key" : "Background key") << " 1920x1080, "
+                      << (vectorized ? "SSE2:   " : "scalar: ") << timer.stop() / iterations
+                      << "ms per frame" << std::endl;
+        }
+    }
+    
+    bool identical = true;
+    int compared = 0;
+    if (doodle::ChromaKey::vectorizedBuild()) {
+        Mat scalarOutput, scalarAlpha;
+        for (int width : {1920, 641, 333, 85, 17, 5, 1}) {
+            Size size(width, 37);
+            background = makeKeyFrame(size, width);
+            frame = makeKeyFrame(size, width + 1);
+            for (Mode mode : modes) {
+                bool keyed = keyFrame(key, mode, background, frame, true, output, alpha) &&
+                             keyFrame(key, mode, background, frame, false, scalarOutput,
+                                      scalarAlpha);
+                identical = identical && keyed && norm(output, scalarOutput, NORM_INF) == 0 &&
+                            norm(alpha, scalarAlpha, NORM_INF) == 0;
+                compared++;
+            }
+        }
+        std::cout << "SSE2 vs scalar: " << compared << " frames, "
+                  << (identical ? "identical" : "MISMATCH") << std::endl;
+    } else {
+        std::cout << "SSE2 vs scalar: skipped, SSE2 is not compiled in" << std::endl;
+    }
+    std::cout << std::endl;
+    return identical;
+}
+
 /**
  * @brief Main benchmark runner
+ *
+ * --fail-on-alloc makes the run fail if the steady-state loop allocates.
  */
-int main() {
+int main(int argc, char** argv) {
+    bool failOnAlloc = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--fail-on-alloc") == 0) {
+            failOnAlloc = true;
+        }
+    }
+    TrackingMatAllocator::install();
+    
     std::cout << "\n========================================" << std::endl;
     std::cout << "  Live Doodle Performance Benchmark" << std::endl;
     std::cout << "========================================" << std::endl;
@@ -135,10 +962,22 @@ int main() {
     benchmarkDrawingOps();
     benchmarkImageOps();
     benchmarkFPSCounter();
+    benchmarkTextRendering();
+    benchmarkBatchRendering();
+    bool storageMatches = benchmarkCanvasStorage();
+    bool keyMatches = benchmarkChromaKey();
+    uint64_t allocatingFrames = benchmarkSteadyStateAllocations();
+    bool checksPassed = checkStrokeSync() && checkConcurrentStrokes() && checkProjectFile() &&
+                        storageMatches && keyMatches;
     
     std::cout << "\n========================================" << std::endl;
     std::cout << "  Benchmark Complete" << std::endl;
     std::cout << "========================================\n" << std::endl;
     
-    return 0;
+    if (failOnAlloc && allocatingFrames > 0) {
+        std::cerr << "FAILED: steady-state loop allocated in " << allocatingFrames
+                  << " frames" << std::endl;
+        return 1;
+    }
+    return checksPassed ? 0 : 1;
 }
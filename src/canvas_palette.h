@@ -0,0 +1,377 @@
+/**
+ * @file canvas_palette.h
+ * @brief Palette and coverage encoding for palette-indexed canvases
+ * @author Chethana G
+ * @date 2026-10-19
+ *
+ * Doodles use a handful of colors plus anti-aliased edges, so a canvas can
+ * be stored as one byte per pixel instead of three. In an indexed canvas
+ * (CV_8UC1) the high nibble of a pixel selects one of 15 palette colors
+ * (0 means nothing is drawn) and the low nibble is how much of that color
+ * covers the pixel, in 15 steps. The canvas, its history and the shape
+ * tools' preview buffers all shrink to a third, and clears, fills and undo
+ * copies move a third of the bytes.
+ *
+ * Tools rasterize into a coverage scratch buffer that is merged into the
+ * index plane. The compositor expands indices to BGR through a 256-entry
+ * table, fused with the add onto the camera frame.
+ *
+ * When all 15 slots are taken, a new color is painted with the nearest
+ * existing one and counted as remapped. compact() frees the slots no pixel
+ * of the canvas or its history uses any more, so colors that were cleared
+ * or fell out of the undo depth make room again.
+ */
+
+#ifndef CANVAS_PALETTE_H
+#define CANVAS_PALETTE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "overlay_text.h"
+
+namespace doodle {
+
+/**
+ * @class CanvasPalette
+ * @brief Color table, coverage merge and BGR expansion of an indexed canvas
+ */
+class CanvasPalette {
+public:
+    static constexpr int MAX_COLORS = 15;
+    static constexpr int LEVELS = 15;  ///< Full coverage
+
+    CanvasPalette() { clear(); }
+
+    /**
+     * @brief Remove all colors
+     */
+    void clear() {
+        colors_.clear();
+        freeSlots_ = 0;
+        remapped_ = 0;
+        lastRemapped_ = cv::Vec3b(0, 0, 0);
+        rebuild();
+    }
+
+    /**
+     * @brief Replace the colors (e.g. with those saved in a project)
+     */
+    void assign(const std::vector<cv::Vec3b>& colors) {
+        colors_.assign(colors.begin(),
+                       colors.begin() + std::min<size_t>(colors.size(), MAX_COLORS));
+        freeSlots_ = 0;
+        rebuild();
+    }
+
+    /**
+     * @brief Colors by slot (slot s is colors()[s - 1]); freed slots keep their old color
+     */
+    const std::vector<cv::Vec3b>& colors() const { return colors_; }
+
+    /**
+     * @brief Number of slots in use
+     */
+    int used() const {
+        int count = 0;
+        for (size_t s = 1; s <= colors_.size(); s++) {
+            if (!isFree(static_cast<int>(s))) count++;
+        }
+        return count;
+    }
+
+    /**
+     * @brief How many times a new color had to be painted as the nearest one
+     */
+    uint64_t remapped() const { return remapped_; }
+
+    /**
+     * @brief Whether painting a color now would use the nearest existing one
+     */
+    bool wouldRemap(const cv::Scalar& color) const {
+        cv::Vec3b bgr = toBgr(color);
+        if (isBlack(bgr) || freeSlot() != 0) return false;
+        for (size_t i = 0; i < colors_.size(); i++) {
+            if (same(colors_[i], bgr)) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Free the slots that no index plane refers to any more
+     *
+     * Slots keep their numbers, so the canvas and its history stay valid;
+     * new colors take the freed slots. Every plane that can come back onto
+     * the canvas must be passed, including tiles of a project not loaded yet.
+     * @param planes Index planes in use: canvas, history base and patches
+     */
+    void compact(const std::vector<cv::Mat>& planes) {
+        unsigned all = (2u << colors_.size()) - 1;
+        unsigned live = 1;
+        for (const cv::Mat& plane : planes) {
+            for (int y = 0; y < plane.rows && live != all; y++) {
+                const uint8_t* row = plane.ptr<uint8_t>(y);
+                for (int x = 0; x < plane.cols; x++) {
+                    live |= 1u << (row[x] >> 4);
+                }
+            }
+        }
+        freeSlots_ = static_cast<uint16_t>(all & ~live);
+        while (!colors_.empty() && isFree(static_cast<int>(colors_.size()))) {
+            freeSlots_ &= static_cast<uint16_t>(~(1u << colors_.size()));
+            colors_.pop_back();
+        }
+        rebuild();
+    }
+
+    /**
+     * @brief Palette slot for a color
+     *
+     * Black is slot 0: on the additive canvas it means nothing is drawn, so
+     * painting it erases. A new color takes a free slot; once all are taken
+     * the nearest existing color is used.
+     * @return Slot 0-15
+     */
+    int slot(const cv::Scalar& color) {
+        cv::Vec3b bgr = toBgr(color);
+        if (isBlack(bgr)) {
+            return 0;
+        }
+        int nearest = 0;
+        int nearestDistance = 1 << 30;
+        for (size_t i = 0; i < colors_.size(); i++) {
+            if (isFree(static_cast<int>(i) + 1)) continue;
+            int distance = 0;
+            for (int c = 0; c < 3; c++) {
+                int d = colors_[i][c] - bgr[c];
+                distance += d * d;
+            }
+            if (distance < nearestDistance) {
+                nearest = static_cast<int>(i) + 1;
+                nearestDistance = distance;
+            }
+        }
+        if (nearestDistance == 0) {
+            return nearest;
+        }
+        int s = freeSlot();
+        if (s == 0) {
+            // Count each remapped color once, not every paint operation
+            if (!same(bgr, lastRemapped_)) {
+                remapped_++;
+                lastRemapped_ = bgr;
+            }
+            return nearest;
+        }
+        if (s > static_cast<int>(colors_.size())) {
+            colors_.push_back(bgr);
+        } else {
+            colors_[s - 1] = bgr;
+            freeSlots_ &= static_cast<uint16_t>(~(1u << s));
+        }
+        rebuild();
+        return s;
+    }
+
+    /**
+     * @brief Index of a fully covered pixel of a color
+     */
+    uint8_t index(const cv::Scalar& color) {
+        int s = slot(color);
+        return static_cast<uint8_t>(s == 0 ? 0 : (s << 4) | LEVELS);
+    }
+
+    /**
+     * @brief Zeroed coverage buffer for one paint operation
+     * @param size Size of the painted region
+     * @return View into a buffer that only grows
+     */
+    cv::Mat scratch(cv::Size size) {
+        if (scratch_.rows < size.height || scratch_.cols < size.width) {
+            scratch_.create(std::max(scratch_.rows, size.height),
+                            std::max(scratch_.cols, size.width), CV_8UC1);
+        }
+        cv::Mat view = scratch_(cv::Rect(cv::Point(), size));
+        view.setTo(cv::Scalar::all(0));
+        return view;
+    }
+
+    /**
+     * @brief Paint coverage of a color into indexed pixels
+     *
+     * The same color builds up coverage; another color replaces the pixel
+     * where it covers at least as much as what is there; slot 0 erases.
+     * @param indices Indexed canvas region
+     * @param coverage Coverage 0-255 of the same size
+     * @param slot Palette slot to paint
+     */
+    static void merge(cv::Mat indices, const cv::Mat& coverage, int slot) {
+        const uint8_t* levels = coverageLevels();
+        for (int y = 0; y < indices.rows; y++) {
+            uint8_t* dst = indices.ptr<uint8_t>(y);
+            const uint8_t* src = coverage.ptr<uint8_t>(y);
+            for (int x = 0; x < indices.cols; x++) {
+                int level = levels[src[x]];
+                if (level == 0) continue;
+                int oldSlot = dst[x] >> 4;
+                int oldLevel = dst[x] & 15;
+                if (slot == 0) {
+                    int kept = (oldLevel * (LEVELS - level) + LEVELS / 2) / LEVELS;
+                    dst[x] = static_cast<uint8_t>(kept == 0 ? 0 : (oldSlot << 4) | kept);
+                } else if (oldSlot == slot) {
+                    int total = oldLevel + (level * (LEVELS - oldLevel) + LEVELS / 2) / LEVELS;
+                    dst[x] = static_cast<uint8_t>((slot << 4) | total);
+                } else if (level >= oldLevel) {
+                    dst[x] = static_cast<uint8_t>((slot << 4) | level);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Expand indexed pixels to BGR
+     * @param indices Indexed canvas or region
+     * @param bgr Destination; a same-sized CV_8UC3 view is written in place
+     */
+    void expand(const cv::Mat& indices, cv::Mat& bgr) const {
+        bgr.create(indices.size(), CV_8UC3);
+        ExpandBody body(table_.data(), indices, bgr, false);
+        cv::parallel_for_(cv::Range(0, indices.rows), body);
+    }
+
+    /**
+     * @brief Add the expanded colors of indexed pixels onto a BGR image
+     *
+     * Same result as adding expand(indices) with saturation, in one pass and
+     * without the intermediate image. Runs of empty pixels are skipped eight
+     * at a time.
+     * @param indices Indexed canvas region
+     * @param bgr BGR image of the same size
+     */
+    void addTo(const cv::Mat& indices, cv::Mat& bgr) const {
+        ExpandBody body(table_.data(), indices, bgr, true);
+        cv::parallel_for_(cv::Range(0, indices.rows), body);
+    }
+
+    /**
+     * @brief Draw slot usage and remapped colors on image
+     * @param img Target image
+     * @param position Text position
+     */
+    void drawOverlay(cv::Mat& img, cv::Point position) const {
+        char text[64];
+        std::snprintf(text, sizeof(text), "Palette: %d/%d colors | %llu remapped", used(),
+                      MAX_COLORS, static_cast<unsigned long long>(remapped_));
+        cv::Scalar color = remapped_ > 0 ? cv::Scalar(0, 128, 255) : cv::Scalar(255, 255, 0);
+        performance::drawOverlayText(img, text, position, 0.5, color, 1);
+    }
+
+private:
+    // Expands or adds a band of rows through the color table
+    class ExpandBody : public cv::ParallelLoopBody {
+    public:
+        ExpandBody(const uint8_t* table, const cv::Mat& indices, cv::Mat& bgr, bool add)
+            : table_(table), indices_(indices), bgr_(bgr), add_(add) {}
+
+        void operator()(const cv::Range& rows) const override {
+            for (int y = rows.start; y < rows.end; y++) {
+                const uint8_t* src = indices_.ptr<uint8_t>(y);
+                uint8_t* dst = bgr_.ptr<uint8_t>(y);
+                int cols = indices_.cols;
+                if (!add_) {
+                    for (int x = 0; x < cols; x++, dst += 3) {
+                        std::memcpy(dst, table_ + src[x] * 3, 3);
+                    }
+                    continue;
+                }
+                int x = 0;
+                while (x < cols) {
+                    if (x + 8 <= cols) {
+                        uint64_t eight;
+                        std::memcpy(&eight, src + x, 8);
+                        if (eight == 0) {
+                            x += 8;
+                            continue;
+                        }
+                    }
+                    if (src[x]) {
+                        const uint8_t* color = table_ + src[x] * 3;
+                        uint8_t* d = dst + x * 3;
+                        for (int c = 0; c < 3; c++) {
+                            d[c] = static_cast<uint8_t>(std::min(d[c] + color[c], 255));
+                        }
+                    }
+                    x++;
+                }
+            }
+        }
+
+    private:
+        const uint8_t* table_;
+        const cv::Mat& indices_;
+        cv::Mat& bgr_;
+        bool add_;
+    };
+
+    static cv::Vec3b toBgr(const cv::Scalar& color) {
+        return cv::Vec3b(cv::saturate_cast<uint8_t>(color[0]),
+                         cv::saturate_cast<uint8_t>(color[1]),
+                         cv::saturate_cast<uint8_t>(color[2]));
+    }
+
+    static bool isBlack(const cv::Vec3b& c) { return c[0] == 0 && c[1] == 0 && c[2] == 0; }
+
+    static bool same(const cv::Vec3b& a, const cv::Vec3b& b) {
+        return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+    }
+
+    bool isFree(int s) const { return (freeSlots_ >> s) & 1; }
+
+    // Lowest freed slot, else the next unused one; 0 when all are taken
+    int freeSlot() const {
+        for (size_t s = 1; s <= colors_.size(); s++) {
+            if (isFree(static_cast<int>(s))) return static_cast<int>(s);
+        }
+        return colors_.size() < MAX_COLORS ? static_cast<int>(colors_.size()) + 1 : 0;
+    }
+
+    // Coverage 0-255 rounded to 0-15
+    static const uint8_t* coverageLevels() {
+        static const std::vector<uint8_t> levels = [] {
+            std::vector<uint8_t> table(256);
+            for (int c = 0; c < 256; c++) {
+                table[c] = static_cast<uint8_t>((c * LEVELS + 127) / 255);
+            }
+            return table;
+        }();
+        return levels.data();
+    }
+
+    // BGR for all 256 indices: palette color scaled by coverage
+    void rebuild() {
+        table_.assign(256 * 3, 0);
+        for (size_t s = 1; s <= colors_.size(); s++) {
+            for (int level = 1; level <= LEVELS; level++) {
+                uint8_t* entry = &table_[((s << 4) | level) * 3];
+                for (int c = 0; c < 3; c++) {
+                    entry[c] = static_cast<uint8_t>((colors_[s - 1][c] * level + LEVELS / 2) /
+                                                    LEVELS);
+                }
+            }
+        }
+    }
+
+    std::vector<cv::Vec3b> colors_;
+    uint16_t freeSlots_;        ///< Bit s set: slot s no longer used by any pixel
+    uint64_t remapped_;
+    cv::Vec3b lastRemapped_;
+    std::vector<uint8_t> table_;
+    cv::Mat scratch_;
+};
+
+}  // namespace doodle
+
+#endif  // CANVAS_PALETTE_H
@@ -0,0 +1,492 @@
+/**
+ * @file chroma_key.h
+ * @brief Chroma-key / background replacement stage for the camera feed
+ * @author Chethana G
+ * @date 2026-10-19
+ *
+ * Runs between capture and compositing. Each pixel gets an alpha value,
+ * either from a color range (green screen) or from its distance to a
+ * learned static background, and the keyed-out part of the frame is
+ * replaced by a color, an image or transparency.
+ *
+ * Both key modes go through lookup tables built when the settings change:
+ * the color key indexes a 32K-entry table with the pixel quantized to 15-bit
+ * BGR (5 bits per channel), the background key indexes a 766-entry table
+ * with the summed per-channel difference. The difference and the blend run
+ * 16 bytes at a time with SSE2 (scalar fallback elsewhere), spans that are
+ * fully kept or fully replaced are copied, and rows are split across threads
+ * with cv::parallel_for_.
+ */
+
+#ifndef CHROMA_KEY_H
+#define CHROMA_KEY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "overlay_text.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CHROMA_KEY_SSE2 1
+#endif
+
+namespace doodle {
+
+/**
+ * @class ChromaKey
+ * @brief Keys out a color range or a learned background and replaces it
+ *
+ * Steady-state processing does not allocate: the output, alpha plane and
+ * replacement buffers are reused from frame to frame, and per-row scratch
+ * lives on the stack.
+ */
+class ChromaKey {
+public:
+    enum class Mode { Off, Color, Background };
+    enum class Replacement { Color, Image, Transparent };
+
+    struct Settings {
+        Mode mode = Mode::Off;
+        cv::Scalar keyColor = cv::Scalar(0, 255, 0);  ///< BGR color to key out
+        int hueTolerance = 15;         ///< Hue distance keyed out fully (OpenCV units, 0-90)
+        int softness = 10;             ///< Hue distance over which alpha ramps to opaque
+        int minSaturation = 70;        ///< Less saturated pixels are always kept
+        int minValue = 40;             ///< Darker pixels are always kept
+        int backgroundThreshold = 45;  ///< Summed BGR difference still counted as background
+        int learnFrames = 30;          ///< Frames averaged into the learned background
+        Replacement replacement = Replacement::Color;
+        cv::Scalar replaceColor = cv::Scalar(0, 0, 0);
+    };
+
+    ChromaKey()
+        : enabled_(false), vectorized_(true), learned_(0), keyedLast_(false), lastMs_(0.0) {
+        configure(settings_);
+    }
+
+    /**
+     * @brief Apply new settings and rebuild the lookup tables
+     *
+     * Switching to background mode starts learning the background.
+     */
+    void configure(const Settings& settings) {
+        settings_ = settings;
+        settings_.learnFrames = std::max(settings_.learnFrames, 1);
+        enabled_ = settings_.mode != Mode::Off;
+        fill_.release();
+        buildColorTable();
+        buildDifferenceTable();
+        learnBackground();
+    }
+
+    const Settings& settings() const { return settings_; }
+
+    /**
+     * @brief Image shown where the frame is keyed out (Replacement::Image)
+     * @return False if the image is empty or not 8-bit BGR
+     */
+    bool setReplacementImage(const cv::Mat& image) {
+        if (image.empty() || image.type() != CV_8UC3) {
+            return false;
+        }
+        source_ = image;
+        image_.release();
+        return true;
+    }
+
+    /**
+     * @brief Forget the learned background and average the next frames
+     */
+    void learnBackground() {
+        learned_ = 0;
+        background_.release();
+    }
+
+    bool learning() const {
+        return settings_.mode == Mode::Background && learned_ < settings_.learnFrames;
+    }
+
+    /**
+     * @brief Turn keying on or off without losing the settings
+     */
+    void setEnabled(bool enabled) { enabled_ = enabled && settings_.mode != Mode::Off; }
+    bool enabled() const { return enabled_; }
+
+    /**
+     * @brief Whether outputs should carry the key as an alpha channel
+     */
+    bool transparent() const {
+        return settings_.mode != Mode::Off && settings_.replacement == Replacement::Transparent;
+    }
+
+    /**
+     * @brief Key a frame
+     * @param frame 8-bit BGR camera frame
+     * @param output Keyed frame, reused across calls
+     * @return False if the frame was not keyed (off, learning or unsupported
+     *         type); output is then left untouched
+     */
+    bool process(const cv::Mat& frame, cv::Mat& output) {
+        keyedLast_ = false;
+        if (!enabled_ || frame.type() != CV_8UC3) {
+            return false;
+        }
+        int64_t start = cv::getTickCount();
+        if (settings_.mode == Mode::Background && !learning() &&
+            background_.size() != frame.size()) {
+            learnBackground();
+        }
+        if (settings_.mode == Mode::Background && !accumulate(frame)) {
+            lastMs_ = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+            return false;
+        }
+        prepareReplacement(frame.size());
+        output.create(frame.size(), CV_8UC3);
+        alpha_.create(frame.size(), CV_8UC1);
+
+        KeyBody body(*this, frame, output, alpha_);
+        cv::parallel_for_(cv::Range(0, frame.rows), body);
+        keyedLast_ = true;
+        lastMs_ = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+        return true;
+    }
+
+    /**
+     * @brief Alpha of the last keyed frame (255 = kept, 0 = replaced)
+     */
+    const cv::Mat& alpha() const { return alpha_; }
+
+    /**
+     * @brief Add an alpha channel to a composite of the last keyed frame
+     *
+     * Keyed-out pixels are black in transparent mode, so whatever was drawn
+     * over them (doodles, labels) is already premultiplied; its brightness
+     * becomes its alpha. Frames that were not keyed come out opaque.
+     * @param composite 8-bit BGR composite
+     * @param bgra Premultiplied BGRA result, reused across calls
+     */
+    void exportTransparent(const cv::Mat& composite, cv::Mat& bgra) const {
+        bgra.create(composite.size(), CV_8UC4);
+        bool keyed = keyedLast_ && alpha_.size() == composite.size();
+        AlphaBody body(composite, keyed ? &alpha_ : nullptr, bgra);
+        cv::parallel_for_(cv::Range(0, composite.rows), body);
+    }
+
+    double lastMs() const { return lastMs_; }
+
+    /**
+     * @brief Use the SSE2 loops where they are compiled in (the default)
+     *
+     * Turning them off runs the scalar loops instead, so the two can be
+     * compared on the same frame.
+     */
+    void setVectorized(bool vectorized) { vectorized_ = vectorized; }
+
+    /**
+     * @brief Whether this build has the SSE2 loops
+     */
+    static bool vectorizedBuild() {
+#ifdef CHROMA_KEY_SSE2
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Draw the key mode and its cost for the last frame
+     */
+    void drawOverlay(cv::Mat& img, cv::Point pos) const {
+        char text[64];
+        if (learning()) {
+            std::snprintf(text, sizeof(text), "Key: learning background %d/%d", learned_,
+                          settings_.learnFrames);
+        } else {
+            std::snprintf(text, sizeof(text), "Key: %s %.2f ms",
+                          settings_.mode == Mode::Color ? "color" : "background", lastMs_);
+        }
+        performance::drawOverlayText(img, text, pos, 0.5, cv::Scalar(0, 255, 255), 1);
+    }
+
+    /**
+     * @brief Parse "off", "color" or "background"
+     */
+    static bool parseMode(const std::string& text, Mode& mode) {
+        if (text == "off") mode = Mode::Off;
+        else if (text == "color") mode = Mode::Color;
+        else if (text == "background") mode = Mode::Background;
+        else return false;
+        return true;
+    }
+
+    /**
+     * @brief Parse "color", "image" or "transparent"
+     */
+    static bool parseReplacement(const std::string& text, Replacement& replacement) {
+        if (text == "color") replacement = Replacement::Color;
+        else if (text == "image") replacement = Replacement::Image;
+        else if (text == "transparent") replacement = Replacement::Transparent;
+        else return false;
+        return true;
+    }
+
+private:
+    static constexpr int COLOR_TABLE_SIZE = 1 << 15;
+    static constexpr int DIFFERENCE_TABLE_SIZE = 3 * 255 + 1;
+    static constexpr int SPAN = 256;  ///< Pixels keyed per step with stack scratch
+
+    // Keys a band of rows
+    class KeyBody : public cv::ParallelLoopBody {
+    public:
+        KeyBody(const ChromaKey& key, const cv::Mat& frame, cv::Mat& output, cv::Mat& alpha)
+            : key_(key), frame_(frame), output_(output), alpha_(alpha) {}
+
+        void operator()(const cv::Range& rows) const override {
+            for (int y = rows.start; y < rows.end; y++) {
+                key_.keyRow(frame_.ptr<uint8_t>(y), output_.ptr<uint8_t>(y),
+                            alpha_.ptr<uint8_t>(y), y, frame_.cols);
+            }
+        }
+
+    private:
+        const ChromaKey& key_;
+        const cv::Mat& frame_;
+        cv::Mat& output_;
+        cv::Mat& alpha_;
+    };
+
+    // Builds premultiplied BGRA rows
+    class AlphaBody : public cv::ParallelLoopBody {
+    public:
+        AlphaBody(const cv::Mat& composite, const cv::Mat* alpha, cv::Mat& bgra)
+            : composite_(composite), alpha_(alpha), bgra_(bgra) {}
+
+        void operator()(const cv::Range& rows) const override {
+            for (int y = rows.start; y < rows.end; y++) {
+                const uint8_t* src = composite_.ptr<uint8_t>(y);
+                const uint8_t* key = alpha_ ? alpha_->ptr<uint8_t>(y) : nullptr;
+                uint8_t* dst = bgra_.ptr<uint8_t>(y);
+                for (int x = 0; x < composite_.cols; x++, src += 3, dst += 4) {
+                    dst[0] = src[0];
+                    dst[1] = src[1];
+                    dst[2] = src[2];
+                    dst[3] = key ? std::max({key[x], src[0], src[1], src[2]}) : 255;
+                }
+            }
+        }
+
+    private:
+        const cv::Mat& composite_;
+        const cv::Mat* alpha_;
+        cv::Mat& bgra_;
+    };
+
+    // Key one row in spans, copying spans that are all kept or all replaced
+    void keyRow(const uint8_t* src, uint8_t* dst, uint8_t* alpha, int y, int cols) const {
+        const uint8_t* learned =
+            settings_.mode == Mode::Background ? background_.ptr<uint8_t>(y) : nullptr;
+        const uint8_t* replace = image_.empty() ? fill_.ptr<uint8_t>(0) : image_.ptr<uint8_t>(y);
+
+        uint8_t scratch[SPAN * 3];
+        for (int x = 0; x < cols; x += SPAN) {
+            int n = std::min(SPAN, cols - x);
+            const uint8_t* s = src + x * 3;
+            uint8_t* a = alpha + x;
+            uint8_t all = 0xFF;
+            uint8_t any = 0;
+            if (learned) {
+                absDiff(s, learned + x * 3, scratch, n * 3, vectorized_);
+                for (int i = 0; i < n; i++) {
+                    const uint8_t* d = scratch + i * 3;
+                    a[i] = differenceTable_[d[0] + d[1] + d[2]];
+                    all &= a[i];
+                    any |= a[i];
+                }
+            } else {
+                for (int i = 0; i < n; i++) {
+                    const uint8_t* p = s + i * 3;
+                    a[i] = colorTable_[((p[0] >> 3) << 10) | ((p[1] >> 3) << 5) | (p[2] >> 3)];
+                    all &= a[i];
+                    any |= a[i];
+                }
+            }
+
+            if (all == 0xFF) {
+                std::memcpy(dst + x * 3, s, n * 3);
+            } else if (any == 0) {
+                std::memcpy(dst + x * 3, replace + x * 3, n * 3);
+            } else {
+                for (int i = 0; i < n; i++) {
+                    scratch[i * 3] = scratch[i * 3 + 1] = scratch[i * 3 + 2] = a[i];
+                }
+                blend(s, replace + x * 3, scratch, dst + x * 3, n * 3, vectorized_);
+            }
+        }
+    }
+
+    // Per-byte |a - b|
+    static void absDiff(const uint8_t* a, const uint8_t* b, uint8_t* out, int n,
+                        bool vectorized) {
+        int i = 0;
+#ifdef CHROMA_KEY_SSE2
+        for (; vectorized && i + 16 <= n; i += 16) {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+            __m128i d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), d);
+        }
+#else
+        (void)vectorized;
+#endif
+        for (; i < n; i++) {
+            out[i] = static_cast<uint8_t>(std::abs(a[i] - b[i]));
+        }
+    }
+
+    // Per-byte (fg * a + bg * (255 - a)) / 255, rounded
+    static void blend(const uint8_t* fg, const uint8_t* bg, const uint8_t* alpha, uint8_t* out,
+                      int n, bool vectorized) {
+        int i = 0;
+#ifdef CHROMA_KEY_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i full = _mm_set1_epi16(255);
+        const __m128i half = _mm_set1_epi16(128);
+        for (; vectorized && i + 16 <= n; i += 16) {
+            __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(fg + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bg + i));
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(alpha + i));
+            __m128i lo = blend16(_mm_unpacklo_epi8(f, zero), _mm_unpacklo_epi8(b, zero),
+                                 _mm_unpacklo_epi8(a, zero), full, half);
+            __m128i hi = blend16(_mm_unpackhi_epi8(f, zero), _mm_unpackhi_epi8(b, zero),
+                                 _mm_unpackhi_epi8(a, zero), full, half);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(lo, hi));
+        }
+#else
+        (void)vectorized;
+#endif
+        for (; i < n; i++) {
+            unsigned t = fg[i] * alpha[i] + bg[i] * (255u - alpha[i]) + 128u;
+            out[i] = static_cast<uint8_t>((t + (t >> 8)) >> 8);
+        }
+    }
+
+#ifdef CHROMA_KEY_SSE2
+    // Eight 16-bit lanes of the blend; the sum stays below 2^16
+    static __m128i blend16(__m128i f, __m128i b, __m128i a, __m128i full, __m128i half) {
+        __m128i t = _mm_add_epi16(_mm_mullo_epi16(f, a),
+                                  _mm_mullo_epi16(b, _mm_sub_epi16(full, a)));
+        t = _mm_add_epi16(t, half);
+        return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    }
+#endif
+
+    // Average the first learnFrames frames into the background model
+    bool accumulate(const cv::Mat& frame) {
+        if (!learning()) {
+            return true;
+        }
+        if (learned_ == 0 || mean_.size() != frame.size()) {
+            frame.convertTo(mean_, CV_32FC3);
+            learned_ = 0;
+        } else {
+            cv::accumulateWeighted(frame, mean_, 1.0 / (learned_ + 1));
+        }
+        if (++learned_ == settings_.learnFrames) {
+            mean_.convertTo(background_, CV_8UC3);
+            mean_.release();
+            return true;
+        }
+        return false;
+    }
+
+    // Size the replacement image and color row to the frame
+    void prepareReplacement(cv::Size size) {
+        if (settings_.replacement == Replacement::Image && !source_.empty()) {
+            if (image_.size() != size) {
+                cv::resize(source_, image_, size, 0, 0, cv::INTER_AREA);
+            }
+        } else {
+            image_.release();
+        }
+        if (fill_.cols != size.width) {
+            cv::Scalar color = settings_.replacement == Replacement::Transparent
+                                   ? cv::Scalar::all(0)
+                                   : settings_.replaceColor;
+            fill_.create(1, size.width, CV_8UC3);
+            fill_.setTo(color);
+        }
+    }
+
+    // Alpha for every 15-bit BGR color from its hue distance to the key color
+    void buildColorTable() {
+        cv::Mat colors(1, COLOR_TABLE_SIZE, CV_8UC3);
+        for (int i = 0; i < COLOR_TABLE_SIZE; i++) {
+            cv::Vec3b& c = colors.at<cv::Vec3b>(0, i);
+            c[0] = static_cast<uint8_t>(((i >> 10) & 31) << 3 | 4);
+            c[1] = static_cast<uint8_t>(((i >> 5) & 31) << 3 | 4);
+            c[2] = static_cast<uint8_t>((i & 31) << 3 | 4);
+        }
+        cv::Mat hsv;
+        cv::cvtColor(colors, hsv, cv::COLOR_BGR2HSV);
+
+        cv::Mat key(1, 1, CV_8UC3, settings_.keyColor);
+        cv::Mat keyHsv;
+        cv::cvtColor(key, keyHsv, cv::COLOR_BGR2HSV);
+        int keyHue = keyHsv.at<cv::Vec3b>(0, 0)[0];
+
+        int tolerance = std::max(settings_.hueTolerance, 0);
+        int softness = std::max(settings_.softness, 1);
+        colorTable_.resize(COLOR_TABLE_SIZE);
+        for (int i = 0; i < COLOR_TABLE_SIZE; i++) {
+            const cv::Vec3b& c = hsv.at<cv::Vec3b>(0, i);
+            int distance = std::abs(c[0] - keyHue);
+            distance = std::min(distance, 180 - distance);
+            int alpha = 255;
+            if (c[1] >= settings_.minSaturation && c[2] >= settings_.minValue) {
+                alpha = ramp(distance - tolerance, softness);
+            }
+            colorTable_[i] = static_cast<uint8_t>(alpha);
+        }
+    }
+
+    // Alpha for every summed difference from the learned background
+    void buildDifferenceTable() {
+        int threshold = std::max(settings_.backgroundThreshold, 0);
+        int softness = std::max(threshold / 2, 1);
+        differenceTable_.resize(DIFFERENCE_TABLE_SIZE);
+        for (int d = 0; d < DIFFERENCE_TABLE_SIZE; d++) {
+            differenceTable_[d] = static_cast<uint8_t>(ramp(d - threshold, softness));
+        }
+    }
+
+    // 0 at or below zero, 255 from width up, linear in between
+    static int ramp(int value, int width) {
+        if (value <= 0) return 0;
+        if (value >= width) return 255;
+        return value * 255 / width;
+    }
+
+    Settings settings_;
+    bool enabled_;
+    bool vectorized_;
+    int learned_;
+    bool keyedLast_;
+    double lastMs_;
+    std::vector<uint8_t> colorTable_;
+    std::vector<uint8_t> differenceTable_;
+    cv::Mat mean_;        ///< Running average while learning (CV_32FC3)
+    cv::Mat background_;  ///< Learned background
+    cv::Mat source_;      ///< Replacement image as loaded
+    cv::Mat image_;       ///< Replacement image at frame size
+    cv::Mat fill_;        ///< One row of the replacement color
+    cv::Mat alpha_;
+};
+
+}  // namespace doodle
+
+#endif  // CHROMA_KEY_H
@@ -0,0 +1,162 @@
+/**
+ * @file compositor.h
+ * @brief Composites the drawing layer over camera frames
+ * @author Chethana G
+ * @date 2026-10-19
+ */
+
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+#include "canvas_palette.h"
+
+namespace doodle {
+
+/**
+ * @class Compositor
+ * @brief Adds the drawing layer onto the camera frame
+ *
+ * The result is the same as addWeighted(frame, 1, canvas, 1, 0), but the
+ * blend only runs over the occupied region: the union of all damage reported
+ * since the canvas was last cleared. Outside it the canvas is known to be
+ * black, so the frame is copied straight through.
+ *
+ * With a transform set (scene-anchored drawing), the canvas is in anchor
+ * coordinates and only the occupied region is warped into the frame. The
+ * canvas keeps the size of the anchor frame and does not grow on pan: parts
+ * of the view that were outside the anchor frame show the camera only and
+ * cannot be drawn on. live_doodle refuses strokes that start there, outlines
+ * the canvas in the HUD, and re-anchors on clear.
+ *
+ * A palette-indexed canvas is expanded to BGR only here: untransformed, the
+ * expansion is fused with the add; warped, the occupied region is expanded
+ * into a scratch buffer first.
+ *
+ * Steady-state compositing does not allocate: the transform is a Matx, and
+ * the warp writes into a canvas-sized scratch buffer through an ROI.
+ */
+class Compositor {
+public:
+    /**
+     * @brief Grow the occupied region by a damage rectangle
+     */
+    void addDamage(const cv::Rect& damage) {
+        if (damage.empty()) return;
+        occupied_ = occupied_.empty() ? damage : (occupied_ | damage);
+    }
+
+    /**
+     * @brief Forget the occupied region (after the canvas was cleared)
+     */
+    void reset() { occupied_ = cv::Rect(); }
+
+    /**
+     * @brief Set the homography from canvas to frame coordinates
+     */
+    void setTransform(const cv::Matx33d& transform) {
+        transform_ = transform;
+        transformed_ = true;
+    }
+
+    /**
+     * @brief Composite without a transform again
+     */
+    void clearTransform() { transformed_ = false; }
+
+    /**
+     * @brief Palette of an indexed canvas, or nullptr for a BGR canvas
+     */
+    void setPalette(const CanvasPalette* palette) { palette_ = palette; }
+
+    /**
+     * @brief Composite a canvas over a frame
+     * @param frame Camera frame
+     * @param canvas Drawing layer of the same size, and of the same type or indexed
+     * @param output Destination, reallocated only if its size or type differs
+     */
+    void composite(const cv::Mat& frame, const cv::Mat& canvas, cv::Mat& output) const {
+        frame.copyTo(output);
+        if (transformed_) {
+            compositeWarped(canvas, output);
+            return;
+        }
+        cv::Rect roi = occupied_ & cv::Rect(0, 0, frame.cols, frame.rows);
+        if (!roi.empty()) {
+            cv::Mat target = output(roi);
+            if (palette_) {
+                palette_->addTo(canvas(roi), target);
+            } else {
+                cv::add(target, canvas(roi), target);
+            }
+        }
+    }
+
+    const cv::Rect& occupied() const { return occupied_; }
+
+private:
+    void compositeWarped(const cv::Mat& canvas, cv::Mat& output) const {
+        cv::Rect source = occupied_ & cv::Rect(0, 0, canvas.cols, canvas.rows);
+        if (source.empty()) return;
+
+        // Where the occupied region lands in the frame
+        const int xs[4] = {source.x, source.br().x, source.br().x, source.x};
+        const int ys[4] = {source.y, source.y, source.br().y, source.br().y};
+        double minX = 1e9, minY = 1e9, maxX = -1e9, maxY = -1e9;
+        for (int i = 0; i < 4; i++) {
+            const cv::Matx33d& h = transform_;
+            double w = h(2, 0) * xs[i] + h(2, 1) * ys[i] + h(2, 2);
+            if (std::abs(w) < 1e-9) return;
+            double x = (h(0, 0) * xs[i] + h(0, 1) * ys[i] + h(0, 2)) / w;
+            double y = (h(1, 0) * xs[i] + h(1, 1) * ys[i] + h(1, 2)) / w;
+            minX = std::min(minX, x);
+            minY = std::min(minY, y);
+            maxX = std::max(maxX, x);
+            maxY = std::max(maxY, y);
+        }
+        cv::Rect frameRect(0, 0, output.cols, output.rows);
+        if (maxX < 0 || maxY < 0 || minX > output.cols || minY > output.rows) return;
+        int x0 = cvFloor(minX), y0 = cvFloor(minY);
+        cv::Rect target = cv::Rect(x0, y0, cvCeil(maxX) - x0 + 1, cvCeil(maxY) - y0 + 1) &
+                          frameRect;
+        if (target.empty()) return;
+
+        // Warp between the two regions only: T(-target) * H * T(source)
+        cv::Matx33d toSource(1, 0, source.x, 0, 1, source.y, 0, 0, 1);
+        cv::Matx33d fromTarget(1, 0, -target.x, 0, 1, -target.y, 0, 0, 1);
+        cv::Matx33d local = fromTarget * transform_ * toSource;
+
+        // The target is clipped to the frame, so a frame-sized buffer holds any warp
+        if (warped_.rows < output.rows || warped_.cols < output.cols ||
+            warped_.type() != output.type()) {
+            warped_.create(output.size(), output.type());
+        }
+        cv::Mat warped = warped_(cv::Rect(0, 0, target.width, target.height));
+        cv::Mat layer = canvas(source);
+        if (palette_) {
+            // Interpolating indices is meaningless, so warp the expanded colors
+            if (expanded_.rows < canvas.rows || expanded_.cols < canvas.cols) {
+                expanded_.create(canvas.size(), CV_8UC3);
+            }
+            layer = expanded_(cv::Rect(0, 0, source.width, source.height));
+            palette_->expand(canvas(source), layer);
+        }
+        cv::warpPerspective(layer, warped, local, target.size(), cv::INTER_LINEAR,
+                            cv::BORDER_CONSTANT, cv::Scalar::all(0));
+        cv::Mat region = output(target);
+        cv::add(region, warped, region);
+    }
+
+    cv::Rect occupied_;
+    cv::Matx33d transform_;
+    bool transformed_ = false;
+    const CanvasPalette* palette_ = nullptr;
+    mutable cv::Mat warped_;
+    mutable cv::Mat expanded_;
+};
+
+}  // namespace doodle
+
+#endif  // COMPOSITOR_H
@@ -0,0 +1,157 @@
+/**
+ * @file configuration.h
+ * @brief Loading of application settings from config.json
+ * @author Chethana G
+ * @date 2026-10-19
+ */
+
+#ifndef CONFIGURATION_H
+#define CONFIGURATION_H
+
+#include <string>
+#include <opencv2/opencv.hpp>
+
+/**
+ * @struct Configuration
+ * @brief Application settings, initialized to the built-in defaults
+ */
+struct Configuration {
+    int cameraDeviceId = 0;
+    int frameWidth = 640;
+    int frameHeight = 480;
+    int cameraFps = 30;
+    int defaultBrushSize = 3;
+    int maxBrushSize = 20;
+    int minBrushSize = 1;
+    std::string canvasStorage = "bgr";  ///< "bgr" or "indexed" (palette, 1 byte/pixel)
+    int maxUndoLevels = 20;
+    int canvasBudgetMB = 0;    ///< 0 means unlimited
+    int historyBudgetMB = 64;
+    int previewBudgetMB = 0;
+    int uiBudgetMB = 0;
+    int exportBudgetMB = 0;
+    bool stabilize = false;
+    int stabilizeBudgetMs = 4;      ///< Longest wait for motion per frame
+    int stabilizeMaxFeatures = 200;
+    int stabilizeTrackWidth = 480;  ///< Tracking runs at this width
+    std::string shmOutput;          ///< Shared-memory frame output, empty for none
+    int shmSlots = 4;
+    int mjpegPort = 0;              ///< Localhost MJPEG preview port, 0 for none
+    int mjpegQuality = 80;
+    std::string chromaKey = "off";  ///< "off", "color" or "background"
+    cv::Scalar keyColor = cv::Scalar(0, 255, 0);
+    int keyHueTolerance = 15;
+    int keySoftness = 10;
+    int keyMinSaturation = 70;
+    int keyMinValue = 40;
+    int keyBackgroundThreshold = 45;
+    int keyLearnFrames = 30;
+    std::string keyReplacement = "color";  ///< "color", "image" or "transparent"
+    cv::Scalar keyReplaceColor = cv::Scalar(0, 0, 0);
+    std::string keyReplaceImage;
+    bool showHelpOnStartup = true;
+    bool showColorPalette = true;
+    std::string windowTitle = "Live Doodle on Camera - Advanced";
+};
+
+namespace config_detail {
+
+inline int readInt(const cv::FileNode& node, int fallback) {
+    return (node.isInt() || node.isReal()) ? static_cast<int>(node) : fallback;
+}
+
+inline bool readBool(const cv::FileNode& node, bool fallback) {
+    // The JSON reader stores true/false as integers
+    return node.isInt() ? static_cast<int>(node) != 0 : fallback;
+}
+
+inline std::string readString(const cv::FileNode& node, const std::string& fallback) {
+    return node.isString() ? static_cast<std::string>(node) : fallback;
+}
+
+inline cv::Scalar readColor(const cv::FileNode& node, const cv::Scalar& fallback) {
+    if (!node.isSeq() || node.size() != 3) {
+        return fallback;
+    }
+    return cv::Scalar(readInt(node[0], 0), readInt(node[1], 0), readInt(node[2], 0));
+}
+
+}  // namespace config_detail
+
+/**
+ * @brief Load application settings from a JSON file
+ * @param filename Path to config.json
+ * @param config Configuration structure to populate; keys missing from the
+ *               file keep their current values
+ * @return False if the file was not found or could not be parsed
+ */
+inline bool loadConfiguration(const std::string& filename, Configuration& config) {
+    using namespace config_detail;
+
+    cv::FileStorage fs;
+    try {
+        if (!fs.open(filename, cv::FileStorage::READ)) {
+            return false;
+        }
+    } catch (const cv::Exception&) {
+        return false;
+    }
+
+    cv::FileNode camera = fs["camera"];
+    config.cameraDeviceId = readInt(camera["device_id"], config.cameraDeviceId);
+    config.frameWidth = readInt(camera["resolution"]["width"], config.frameWidth);
+    config.frameHeight = readInt(camera["resolution"]["height"], config.frameHeight);
+    config.cameraFps = readInt(camera["fps"], config.cameraFps);
+
+    cv::FileNode drawing = fs["drawing"];
+    config.defaultBrushSize = readInt(drawing["default_brush_size"], config.defaultBrushSize);
+    config.maxBrushSize = readInt(drawing["max_brush_size"], config.maxBrushSize);
+    config.minBrushSize = readInt(drawing["min_brush_size"], config.minBrushSize);
+    config.canvasStorage = readString(drawing["canvas_storage"], config.canvasStorage);
+
+    cv::FileNode ui = fs["ui"];
+    config.showHelpOnStartup = readBool(ui["show_help_on_startup"], config.showHelpOnStartup);
+    config.showColorPalette = readBool(ui["show_color_palette"], config.showColorPalette);
+    config.windowTitle = readString(ui["window_title"], config.windowTitle);
+
+    cv::FileNode features = fs["features"];
+    config.maxUndoLevels = readInt(features["max_undo_levels"], config.maxUndoLevels);
+
+    cv::FileNode budgets = fs["memory"]["budgets_mb"];
+    config.canvasBudgetMB = readInt(budgets["canvas"], config.canvasBudgetMB);
+    config.historyBudgetMB = readInt(budgets["history"], config.historyBudgetMB);
+    config.previewBudgetMB = readInt(budgets["preview"], config.previewBudgetMB);
+    config.uiBudgetMB = readInt(budgets["ui"], config.uiBudgetMB);
+    config.exportBudgetMB = readInt(budgets["export"], config.exportBudgetMB);
+
+    cv::FileNode stabilization = fs["stabilization"];
+    config.stabilize = readBool(stabilization["enabled"], config.stabilize);
+    config.stabilizeBudgetMs = readInt(stabilization["budget_ms"], config.stabilizeBudgetMs);
+    config.stabilizeMaxFeatures = readInt(stabilization["max_features"],
+                                          config.stabilizeMaxFeatures);
+    config.stabilizeTrackWidth = readInt(stabilization["track_width"],
+                                         config.stabilizeTrackWidth);
+
+    cv::FileNode output = fs["output"];
+    config.shmOutput = readString(output["shared_memory"], config.shmOutput);
+    config.shmSlots = readInt(output["shared_memory_slots"], config.shmSlots);
+    config.mjpegPort = readInt(output["mjpeg_port"], config.mjpegPort);
+    config.mjpegQuality = readInt(output["mjpeg_quality"], config.mjpegQuality);
+
+    cv::FileNode key = fs["chroma_key"];
+    config.chromaKey = readString(key["mode"], config.chromaKey);
+    config.keyColor = readColor(key["key_color"], config.keyColor);
+    config.keyHueTolerance = readInt(key["hue_tolerance"], config.keyHueTolerance);
+    config.keySoftness = readInt(key["softness"], config.keySoftness);
+    config.keyMinSaturation = readInt(key["min_saturation"], config.keyMinSaturation);
+    config.keyMinValue = readInt(key["min_value"], config.keyMinValue);
+    config.keyBackgroundThreshold = readInt(key["background_threshold"],
+                                            config.keyBackgroundThreshold);
+    config.keyLearnFrames = readInt(key["learn_frames"], config.keyLearnFrames);
+    config.keyReplacement = readString(key["replacement"], config.keyReplacement);
+    config.keyReplaceColor = readColor(key["replace_color"], config.keyReplaceColor);
+    config.keyReplaceImage = readString(key["replace_image"], config.keyReplaceImage);
+    return true;
+}
+
+#endif  // CONFIGURATION_H
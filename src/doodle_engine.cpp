@@ -0,0 +1,317 @@
+/**
+ * @file doodle_engine.cpp
+ * @brief DoodleEngine implementation (liblivedoodle)
+ * @author Chethana G
+ * @date 2026-10-19
+ */
+
+#include "doodle_engine.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include "memory_accounting.h"
+
+namespace doodle {
+
+using collab::StrokeOp;
+using collab::StrokeOpType;
+using performance::MemoryTag;
+using performance::ScopedMemoryTag;
+
+DoodleEngine::DoodleEngine(ToolRegistry registry)
+    : registry_(std::move(registry)), strokes_(0), background_(0, 0, 0), lineType_(cv::LINE_AA),
+      labels_(nullptr) {}
+
+void DoodleEngine::reset(cv::Size size, int type) {
+    {
+        ScopedMemoryTag tag(MemoryTag::Canvas);
+        canvas_ = cv::Mat::zeros(size, type);
+    }
+    {
+        ScopedMemoryTag tag(MemoryTag::History);
+        history_.reset(canvas_);
+    }
+    palette_.clear();
+    compositor_.reset();
+    dirty_.clear();
+    compositor_.setPalette(indexed() ? &palette_ : nullptr);
+    local_.active = false;
+    local_.ops.clear();
+    remote_.clear();
+    scratch_.release();
+}
+
+cv::Rect DoodleEngine::apply(const StrokeOp* ops, size_t count) {
+    return run(local_, ops, count, false);
+}
+
+cv::Rect DoodleEngine::applyRemote(uint32_t instanceId, const StrokeOp* ops, size_t count) {
+    return run(remote_[instanceId], ops, count, true);
+}
+
+bool DoodleEngine::undo() {
+    if (canvas_.empty()) return false;
+    if (local_.active) report(cancel(local_));
+    if (prepareHandler_) prepareHandler_();
+    cv::Rect damage;
+    if (!history_.undo(canvas_, damage)) return false;
+    report(damage);
+    return true;
+}
+
+bool DoodleEngine::redo() {
+    if (canvas_.empty()) return false;
+    if (local_.active) report(cancel(local_));
+    if (prepareHandler_) prepareHandler_();
+    cv::Rect damage;
+    if (!history_.redo(canvas_, damage)) return false;
+    report(damage);
+    return true;
+}
+
+bool DoodleEngine::releaseIdleTools() {
+    bool released = false;
+    if (!local_.active && local_.tool) {
+        local_.tool.reset();
+        local_.toolId = -1;
+        released = true;
+    }
+    for (auto it = remote_.begin(); it != remote_.end();) {
+        if (it->second.active) {
+            ++it;
+        } else {
+            it = remote_.erase(it);
+            released = true;
+        }
+    }
+    if (replay_.tool) {
+        replay_.tool.reset();
+        replay_.toolId = -1;
+        released = true;
+    }
+    return released;
+}
+
+// Damage is collected per stroke and reported when the stroke ends or the
+// batch runs out, rather than after every operation
+cv::Rect DoodleEngine::run(Stroke& stroke, const StrokeOp* ops, size_t count, bool remote) {
+    if (count == 0 || canvas_.empty()) return cv::Rect();
+    if (prepareHandler_) prepareHandler_();
+    stroke.context.lineType = lineType_;
+
+    cv::Rect total;
+    cv::Rect pending;
+    for (size_t i = 0; i < count; i++) {
+        const StrokeOp& op = ops[i];
+        cv::Point p(op.x, op.y);
+        switch (op.type) {
+            case StrokeOpType::Begin:
+                pending = unite(pending, begin(stroke, op, remote));
+                break;
+            case StrokeOpType::Move:
+                if (stroke.active) {
+                    stroke.ops.push_back(op);
+                    cv::Rect damage = stroke.tool->update(stroke.context, p);
+                    stroke.damage = unite(stroke.damage, damage);
+                    pending = unite(pending, damage);
+                }
+                break;
+            case StrokeOpType::End:
+                if (stroke.active) {
+                    stroke.ops.push_back(op);
+                    cv::Rect damage = stroke.tool->commit(stroke.context, p);
+                    stroke.damage = unite(stroke.damage, damage);
+                    pending = unite(pending, damage);
+                    commit(stroke, remote);
+                }
+                break;
+            case StrokeOpType::Cancel:
+                if (stroke.active) {
+                    pending = unite(pending, cancel(stroke));
+                }
+                break;
+            case StrokeOpType::Clear:
+                clear(remote);
+                pending = cv::Rect();
+                total = cv::Rect(0, 0, canvas_.cols, canvas_.rows);
+                continue;
+        }
+        if (!stroke.active && !pending.empty()) {
+            report(pending);
+            total = unite(total, pending);
+            pending = cv::Rect();
+        }
+    }
+    report(pending);
+    return unite(total, pending);
+}
+
+cv::Rect DoodleEngine::begin(Stroke& stroke, const StrokeOp& op, bool remote) {
+    if (stroke.active) {
+        commit(stroke, remote);
+    }
+    if (!stroke.tool || stroke.toolId != op.tool) {
+        stroke.tool = registry_.create(op.tool);
+        stroke.toolId = stroke.tool ? op.tool : -1;
+    }
+    if (!stroke.tool) return cv::Rect();
+
+    ToolContext& ctx = stroke.context;
+    ctx.canvas = &canvas_;
+    ctx.color = cv::Scalar(op.color[0], op.color[1], op.color[2]);
+    ctx.background = background_;
+    ctx.size = std::max<int>(op.size, 1);
+    ctx.lineType = lineType_;
+    ctx.seed = op.seed;
+    ctx.labels = remote ? nullptr : labels_;
+    ctx.palette = indexed() ? &palette_ : nullptr;
+    if (ctx.palette && palette_.wouldRemap(ctx.color)) {
+        compactPalette();
+    }
+    stroke.active = true;
+    stroke.ops.assign(1, op);
+    stroke.order = strokes_++;
+
+    ScopedMemoryTag tag(MemoryTag::Preview);
+    stroke.damage = stroke.tool->begin(ctx, cv::Point(op.x, op.y));
+    return stroke.damage;
+}
+
+// Put the base back under the stroke, then draw the strokes still in
+// progress there again
+cv::Rect DoodleEngine::cancel(Stroke& stroke) {
+    cv::Rect damage = stroke.tool->cancel(stroke.context);
+    stroke.active = false;
+    history_.revert(canvas_, stroke.damage);
+    cv::Rect rect = stroke.damage & cv::Rect(0, 0, canvas_.cols, canvas_.rows);
+    std::vector<const Stroke*> others = activeOver(rect, stroke);
+    if (!others.empty()) {
+        ScopedMemoryTag tag(MemoryTag::History);
+        scratch_.create(canvas_.size(), canvas_.type());
+        canvas_(rect).copyTo(scratch_(rect));
+        for (const Stroke* other : others) {
+            replay(*other, scratch_);
+        }
+        scratch_(rect).copyTo(canvas_(rect));
+    }
+    stroke.ops.clear();
+    return unite(damage, stroke.damage);
+}
+
+// Where other strokes in progress overlap this one, the canvas holds their
+// pixels too; the history gets this stroke alone, drawn again over the base
+void DoodleEngine::commit(Stroke& stroke, bool remote) {
+    ScopedMemoryTag tag(MemoryTag::History);
+    const cv::Mat* result = &canvas_;
+    cv::Rect rect = stroke.damage & cv::Rect(0, 0, canvas_.cols, canvas_.rows);
+    const cv::Mat& base = history_.base();
+    if (!rect.empty() && base.size() == canvas_.size() && base.type() == canvas_.type() &&
+        !activeOver(rect, stroke).empty()) {
+        scratch_.create(canvas_.size(), canvas_.type());
+        base(rect).copyTo(scratch_(rect));
+        replay(stroke, scratch_);
+        result = &scratch_;
+    }
+    if (remote) {
+        history_.absorb(*result, stroke.damage);
+    } else {
+        history_.record(*result, stroke.damage);
+    }
+    stroke.active = false;
+    stroke.ops.clear();
+}
+
+void DoodleEngine::clear(bool remote) {
+    // A clear from either side ends the local stroke; committing it later
+    // would build its undo level against a canvas that no longer exists
+    if (local_.active) {
+        cancel(local_);
+    }
+    cv::Rect all(0, 0, canvas_.cols, canvas_.rows);
+    canvas_.setTo(cv::Scalar::all(0));
+    {
+        ScopedMemoryTag tag(MemoryTag::History);
+        if (remote) {
+            history_.absorb(canvas_, all);
+        } else {
+            history_.record(canvas_, all);
+        }
+    }
+    compactPalette();
+    compositor_.reset();
+    dirty_.clear();
+    if (damageHandler_) damageHandler_(all);
+    if (clearHandler_) clearHandler_(remote);
+}
+
+// Strokes in progress, other than one, that have drawn inside a region;
+// oldest first
+std::vector<const DoodleEngine::Stroke*> DoodleEngine::activeOver(const cv::Rect& rect,
+                                                                  const Stroke& except) const {
+    std::vector<const Stroke*> strokes;
+    auto consider = [&](const Stroke& stroke) {
+        if (&stroke != &except && stroke.active && !(stroke.damage & rect).empty()) {
+            strokes.push_back(&stroke);
+        }
+    };
+    consider(local_);
+    for (const auto& entry : remote_) {
+        consider(entry.second);
+    }
+    std::sort(strokes.begin(), strokes.end(),
+              [](const Stroke* a, const Stroke* b) { return a->order < b->order; });
+    return strokes;
+}
+
+// Draw a stroke again from its operations, onto target instead of the
+// canvas. Text labels are left alone; they are not pixels.
+void DoodleEngine::replay(const Stroke& stroke, cv::Mat& target) {
+    if (stroke.ops.empty()) return;
+    if (!replay_.tool || replay_.toolId != stroke.toolId) {
+        replay_.tool = registry_.create(stroke.toolId);
+        replay_.toolId = replay_.tool ? stroke.toolId : -1;
+    }
+    if (!replay_.tool) return;
+    ToolContext ctx = stroke.context;
+    ctx.canvas = &target;
+    ctx.labels = nullptr;
+
+    ScopedMemoryTag tag(MemoryTag::Preview);
+    for (const StrokeOp& op : stroke.ops) {
+        cv::Point p(op.x, op.y);
+        if (op.type == StrokeOpType::Begin) {
+            replay_.tool->begin(ctx, p);
+        } else if (op.type == StrokeOpType::Move) {
+            replay_.tool->update(ctx, p);
+        } else if (op.type == StrokeOpType::End) {
+            replay_.tool->commit(ctx, p);
+        }
+    }
+}
+
+// Free the palette slots that neither the canvas nor the history uses. Tool
+// previews also hold indices, so this waits until no stroke is in progress;
+// the prepare hook has already loaded every saved tile.
+void DoodleEngine::compactPalette() {
+    if (!indexed() || local_.active) return;
+    for (const auto& entry : remote_) {
+        if (entry.second.active) return;
+    }
+    std::vector<cv::Mat> planes{canvas_, history_.base()};
+    for (const auto* levels : {&history_.undoPatches(), &history_.redoPatches()}) {
+        for (const History::Patch& patch : *levels) {
+            planes.push_back(patch.pixels);
+        }
+    }
+    palette_.compact(planes);
+}
+
+void DoodleEngine::report(const cv::Rect& damage) {
+    if (damage.empty()) return;
+    dirty_.markDirty(damage);
+    if (damageHandler_) damageHandler_(damage);
+}
+
+}  // namespace doodle
@@ -0,0 +1,242 @@
+/**
+ * @file doodle_engine.h
+ * @brief Canvas, tools, history and compositor behind one stroke-operation API
+ * @author Chethana G
+ * @date 2026-10-19
+ *
+ * DoodleEngine is the drawing core of live_doodle without the window, the
+ * camera or the network. It is built as the liblivedoodle library, which
+ * both executables, the benchmark and external services link against.
+ * Everything that edits the canvas goes in as collab::StrokeOp values, the
+ * same operations the mouse callback produces and the sync protocol sends,
+ * so a host can drive the engine from a GUI, a replay file or a socket.
+ */
+
+#ifndef DOODLE_ENGINE_H
+#define DOODLE_ENGINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "canvas_palette.h"
+#include "compositor.h"
+#include "history.h"
+#include "performance_monitor.h"
+#include "stroke_op.h"
+#include "text_labels.h"
+#include "tools.h"
+
+namespace doodle {
+
+/**
+ * @class DoodleEngine
+ * @brief Applies stroke operations to a canvas and composites it over frames
+ *
+ * Local operations become undo levels; operations from a remote instance
+ * are folded into the history base, so a local undo never takes back a
+ * peer's stroke. Each remote instance has its own stroke in progress.
+ *
+ * All strokes draw into the one canvas, and each stroke in progress keeps
+ * its operations. Cancelling a stroke puts the history base back over its
+ * area and draws the other strokes in progress there again, oldest first,
+ * so only its own pixels go. A stroke that finishes while others overlap it
+ * is drawn again over the base for the history, so it does not carry their
+ * pixels into an undo level or the base. Both use one canvas-sized scratch
+ * buffer, allocated the first time strokes overlap. A remote clear cancels
+ * the local stroke.
+ *
+ * The batch entry points take a whole array of operations and pay the
+ * per-call costs once: the prepare hook runs once, the line type and memory
+ * tag are set once, and damage is reported once per stroke instead of once
+ * per operation. A tool instance is kept per source and reused while the
+ * source keeps drawing with the same tool, so steady drawing does not
+ * allocate.
+ *
+ * A CV_8UC1 canvas is palette-indexed (see CanvasPalette): a third of the
+ * memory for the canvas, history and previews. Use render() rather than
+ * canvas() wherever BGR pixels are needed. The palette is compacted on
+ * clear, and before a stroke whose color would otherwise be remapped.
+ */
+class DoodleEngine {
+public:
+    /**
+     * @brief Receives every canvas rectangle changed by strokes, undo and clear
+     */
+    using DamageHandler = std::function<void(const cv::Rect&)>;
+
+    /**
+     * @brief Runs before the canvas is edited (e.g. to finish lazy loading)
+     */
+    using PrepareHandler = std::function<void()>;
+
+    /**
+     * @brief Runs after the canvas was cleared; the flag is true for a peer's clear
+     */
+    using ClearHandler = std::function<void(bool remote)>;
+
+    explicit DoodleEngine(ToolRegistry registry = ToolRegistry::withDefaultTools());
+
+    /**
+     * @brief Allocate a blank canvas and start a new history
+     * @param size Canvas size (normally the camera frame size)
+     * @param type Canvas type; CV_8UC1 selects palette-indexed storage
+     */
+    void reset(cv::Size size, int type = CV_8UC3);
+
+    bool empty() const { return canvas_.empty(); }
+    cv::Mat& canvas() { return canvas_; }
+    const cv::Mat& canvas() const { return canvas_; }
+    History& history() { return history_; }
+    Compositor& compositor() { return compositor_; }
+    const ToolRegistry& tools() const { return registry_; }
+    CanvasPalette& palette() { return palette_; }
+
+    /**
+     * @brief Whether the canvas stores palette indices instead of BGR
+     */
+    bool indexed() const { return canvas_.type() == CV_8UC1; }
+
+    /**
+     * @brief The canvas as BGR, expanding palette indices if needed
+     * @param bgr Destination
+     */
+    void render(cv::Mat& bgr) const {
+        if (indexed()) {
+            palette_.expand(canvas_, bgr);
+        } else {
+            canvas_.copyTo(bgr);
+        }
+    }
+
+    void setBackground(const cv::Scalar& background) { background_ = background; }
+
+    /**
+     * @brief Line type for stroke updates from now on (adaptive quality)
+     */
+    void setLineType(int lineType) { lineType_ = lineType; }
+
+    /**
+     * @brief Label layer used by local text-tool strokes
+     */
+    void setLabels(TextLabels* labels) { labels_ = labels; }
+
+    void onDamage(DamageHandler handler) { damageHandler_ = std::move(handler); }
+    void onPrepare(PrepareHandler handler) { prepareHandler_ = std::move(handler); }
+    void onClear(ClearHandler handler) { clearHandler_ = std::move(handler); }
+
+    /**
+     * @brief Apply local operations in order
+     * @param ops Operations
+     * @param count Number of operations
+     * @return Union of the canvas regions changed
+     */
+    cv::Rect apply(const collab::StrokeOp* ops, size_t count);
+    cv::Rect apply(const collab::StrokeOp& op) { return apply(&op, 1); }
+
+    /**
+     * @brief Apply operations received from another instance
+     * @param instanceId Sender; each sender has its own stroke in progress
+     * @param ops Operations
+     * @param count Number of operations
+     * @return Union of the canvas regions changed
+     */
+    cv::Rect applyRemote(uint32_t instanceId, const collab::StrokeOp* ops, size_t count);
+    cv::Rect applyRemote(const collab::StrokeBatch& batch) {
+        return applyRemote(batch.instanceId, batch.ops.data(), batch.ops.size());
+    }
+
+    /**
+     * @brief Whether a local stroke is in progress
+     */
+    bool drawing() const { return local_.active; }
+
+    /**
+     * @brief Drop the tool instances of sources that are not drawing
+     *
+     * Frees their preview buffers (a shape tool keeps a canvas-sized one);
+     * the next stroke from that source creates its tool again.
+     * @return False if there was nothing to drop
+     */
+    bool releaseIdleTools();
+
+    /**
+     * @brief Undo the last local edit, abandoning a local stroke in progress
+     * @return False if there was nothing to undo
+     */
+    bool undo();
+
+    /**
+     * @brief Redo the last undone local edit
+     * @return False if there was nothing to redo
+     */
+    bool redo();
+
+    /**
+     * @brief Region changed by operations since the last composite()
+     */
+    const performance::DirtyRegionTracker& dirtyRegion() const { return dirty_; }
+
+    /**
+     * @brief Composite the canvas over a frame
+     *
+     * The damage collected since the previous frame is handed to the
+     * compositor first, which widens the region it blends.
+     * @param frame Camera frame of the canvas size and type
+     * @param output Destination, reallocated only if its size or type differs
+     */
+    void composite(const cv::Mat& frame, cv::Mat& output) {
+        if (dirty_.isDirty()) {
+            compositor_.addDamage(dirty_.getDirtyRegion());
+            dirty_.clear();
+        }
+        compositor_.composite(frame, canvas_, output);
+    }
+
+private:
+    // One source's stroke in progress and the tool instance it draws with
+    struct Stroke {
+        std::unique_ptr<Tool> tool;
+        int toolId = -1;
+        ToolContext context;
+        cv::Rect damage;
+        bool active = false;
+        std::vector<collab::StrokeOp> ops;  ///< Operations since Begin, to draw it again
+        uint64_t order = 0;                 ///< When it began, among all strokes
+    };
+
+    cv::Rect run(Stroke& stroke, const collab::StrokeOp* ops, size_t count, bool remote);
+    cv::Rect begin(Stroke& stroke, const collab::StrokeOp& op, bool remote);
+    cv::Rect cancel(Stroke& stroke);
+    void commit(Stroke& stroke, bool remote);
+    void clear(bool remote);
+    void report(const cv::Rect& damage);
+    std::vector<const Stroke*> activeOver(const cv::Rect& rect, const Stroke& except) const;
+    void replay(const Stroke& stroke, cv::Mat& target);
+    void compactPalette();
+
+    ToolRegistry registry_;
+    cv::Mat canvas_;
+    CanvasPalette palette_;
+    History history_;
+    Compositor compositor_;
+    performance::DirtyRegionTracker dirty_;
+    Stroke local_;
+    std::map<uint32_t, Stroke> remote_;
+    Stroke replay_;       ///< Tool that draws strokes again
+    cv::Mat scratch_;     ///< Where strokes are drawn again (canvas-sized)
+    uint64_t strokes_;    ///< Strokes begun so far
+    cv::Scalar background_;
+    int lineType_;
+    TextLabels* labels_;
+    DamageHandler damageHandler_;
+    PrepareHandler prepareHandler_;
+    ClearHandler clearHandler_;
+};
+
+}  // namespace doodle
+
+#endif  // DOODLE_ENGINE_H
@@ -0,0 +1,179 @@
+/**
+ * @file frame_pacer.h
+ * @brief Frame pacing with a per-frame deadline and adaptive quality
+ * @author Chethana G
+ * @date 2026-10-19
+ */
+
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <opencv2/opencv.hpp>
+#include "overlay_text.h"
+
+namespace performance {
+
+/**
+ * @brief Rendering quality steps, from best to cheapest
+ *
+ * Each level includes the savings of the levels before it.
+ */
+enum class QualityLevel {
+    Full = 0,        ///< Anti-aliased strokes, full HUD, full-size preview
+    NoAntialiasing,  ///< Strokes drawn with LINE_8 instead of LINE_AA
+    NoHud,           ///< Help overlay and color palette skipped
+    ReducedPreview   ///< Preview window shown at reduced scale
+};
+
+/**
+ * @class FramePacer
+ * @brief Paces the main loop to a target frame rate
+ *
+ * Call beginFrame() once a camera frame has been acquired and endFrame()
+ * when the frame has been presented; endFrame() returns how long to wait
+ * in cv::waitKey() so the loop sleeps, rather than spins, when it is ahead.
+ * Frames whose work runs close to the budget degrade quality one step at a
+ * time; a long run of cheap frames restores it.
+ */
+class FramePacer {
+public:
+    FramePacer(double targetFps = 30.0)
+        : quality_(QualityLevel::Full), deadlineMisses_(0), lastWorkMs_(0.0),
+          slowFrames_(0), fastFrames_(0) {
+        setTargetFps(targetFps);
+    }
+
+    /**
+     * @brief Set the target frame rate
+     * @param fps Frames per second (values <= 0 fall back to 30)
+     */
+    void setTargetFps(double fps) {
+        budgetMs_ = 1000.0 / (fps > 0.0 ? fps : 30.0);
+    }
+
+    /**
+     * @brief Mark the start of a frame's work and set its deadline
+     */
+    void beginFrame() {
+        frameStart_ = Clock::now();
+        deadline_ = frameStart_ + std::chrono::duration_cast<Clock::duration>(
+                                      std::chrono::duration<double, std::milli>(budgetMs_));
+    }
+
+    /**
+     * @brief Mark the end of a frame's work and adapt quality
+     * @return Milliseconds to wait for input before the next frame (>= 1)
+     */
+    int endFrame() {
+        auto now = Clock::now();
+        lastWorkMs_ = std::chrono::duration<double, std::milli>(now - frameStart_).count();
+
+        if (now > deadline_) {
+            deadlineMisses_++;
+        }
+
+        // Degrade quickly when the deadline is at risk, recover slowly
+        if (lastWorkMs_ > budgetMs_ * AT_RISK_RATIO) {
+            fastFrames_ = 0;
+            if (++slowFrames_ >= DEGRADE_AFTER_FRAMES) {
+                slowFrames_ = 0;
+                if (quality_ != QualityLevel::ReducedPreview) {
+                    quality_ = static_cast<QualityLevel>(static_cast<int>(quality_) + 1);
+                }
+            }
+        } else if (lastWorkMs_ < budgetMs_ * HEADROOM_RATIO) {
+            slowFrames_ = 0;
+            if (++fastFrames_ >= RECOVER_AFTER_FRAMES) {
+                fastFrames_ = 0;
+                if (quality_ != QualityLevel::Full) {
+                    quality_ = static_cast<QualityLevel>(static_cast<int>(quality_) - 1);
+                }
+            }
+        } else {
+            slowFrames_ = 0;
+            fastFrames_ = 0;
+        }
+
+        double remainingMs = std::chrono::duration<double, std::milli>(deadline_ - now).count();
+        return std::max(1, static_cast<int>(remainingMs));
+    }
+
+    /**
+     * @brief Line type to rasterize strokes with at the current quality
+     */
+    int lineType() const {
+        return quality_ >= QualityLevel::NoAntialiasing ? cv::LINE_8 : cv::LINE_AA;
+    }
+
+    /**
+     * @brief Whether the help overlay and palette should be drawn
+     */
+    bool showHud() const { return quality_ < QualityLevel::NoHud; }
+
+    /**
+     * @brief Scale factor for the preview window
+     */
+    double previewScale() const {
+        return quality_ >= QualityLevel::ReducedPreview ? REDUCED_PREVIEW_SCALE : 1.0;
+    }
+
+    QualityLevel quality() const { return quality_; }
+    uint64_t deadlineMisses() const { return deadlineMisses_; }
+    double budgetMs() const { return budgetMs_; }
+    double lastWorkMs() const { return lastWorkMs_; }
+
+    /**
+     * @brief Human-readable name of a quality level
+     */
+    static const char* qualityName(QualityLevel level) {
+        switch (level) {
+            case QualityLevel::Full:
+                return "Full";
+            case QualityLevel::NoAntialiasing:
+                return "No AA";
+            case QualityLevel::NoHud:
+                return "No HUD";
+            case QualityLevel::ReducedPreview:
+                return "Reduced";
+        }
+        return "?";
+    }
+
+    /**
+     * @brief Draw quality level and deadline misses on image
+     * @param img Target image
+     * @param position Text position
+     */
+    void drawOverlay(cv::Mat& img, cv::Point position = cv::Point(10, 120)) const {
+        char text[64];
+        std::snprintf(text, sizeof(text), "Quality: %s | Misses: %llu", qualityName(quality_),
+                      static_cast<unsigned long long>(deadlineMisses_));
+        drawOverlayText(img, text, position, 0.5, cv::Scalar(0, 255, 0), 1);
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr double AT_RISK_RATIO = 0.9;
+    static constexpr double HEADROOM_RATIO = 0.5;
+    static constexpr int DEGRADE_AFTER_FRAMES = 3;
+    static constexpr int RECOVER_AFTER_FRAMES = 90;
+    static constexpr double REDUCED_PREVIEW_SCALE = 0.75;
+
+    double budgetMs_;
+    QualityLevel quality_;
+    uint64_t deadlineMisses_;
+    double lastWorkMs_;
+    int slowFrames_;
+    int fastFrames_;
+    Clock::time_point frameStart_;
+    Clock::time_point deadline_;
+};
+
+}  // namespace performance
+
+#endif  // FRAME_PACER_H
@@ -0,0 +1,95 @@
+/**
+ * @file frame_pool.h
+ * @brief Fixed set of reusable frame buffers
+ * @author Chethana G
+ * @date 2026-10-19
+ *
+ * The frame loop writes every composite into a buffer from a FramePool
+ * instead of a fresh Mat. A buffer goes back into rotation as soon as the
+ * last Mat header referring to it outside the pool is gone, so a consumer
+ * can keep a composited frame for a while (to encode or publish it) without
+ * copying it and without forcing an allocation for the next frame.
+ */
+
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <cstdint>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+namespace performance {
+
+/**
+ * @class FramePool
+ * @brief Round-robin pool of equally sized frame buffers
+ */
+class FramePool {
+public:
+    /**
+     * @param capacity Buffers kept in the pool; more are handed out unpooled
+     *                 while all of them are held by consumers
+     */
+    explicit FramePool(size_t capacity = 3) : capacity_(capacity), next_(0), overflows_(0) {
+        buffers_.reserve(capacity_);
+    }
+
+    /**
+     * @brief Get a buffer that nobody outside the pool refers to
+     * @param size Frame size
+     * @param type Frame type
+     * @return Mat sharing the pooled buffer; contents are undefined
+     */
+    cv::Mat acquire(cv::Size size, int type) {
+        if (size != size_ || type != type_) {
+            buffers_.clear();
+            size_ = size;
+            type_ = type;
+            next_ = 0;
+        }
+        for (size_t i = 0; i < buffers_.size(); i++) {
+            size_t index = (next_ + i) % buffers_.size();
+            if (unused(buffers_[index])) {
+                next_ = (index + 1) % buffers_.size();
+                return buffers_[index];
+            }
+        }
+        if (buffers_.size() < capacity_) {
+            buffers_.emplace_back(size, type);
+            return buffers_.back();
+        }
+        overflows_++;
+        return cv::Mat(size, type);
+    }
+
+    /**
+     * @brief Drop all buffers
+     */
+    void clear() {
+        buffers_.clear();
+        next_ = 0;
+    }
+
+    size_t size() const { return buffers_.size(); }
+    size_t capacity() const { return capacity_; }
+
+    /**
+     * @brief Number of acquire() calls that had to allocate outside the pool
+     */
+    uint64_t overflows() const { return overflows_; }
+
+private:
+    // Only the pool's own header refers to the buffer
+    static bool unused(const cv::Mat& buffer) { return buffer.u && buffer.u->refcount == 1; }
+
+    size_t capacity_;
+    size_t next_;
+    uint64_t overflows_;
+    cv::Size size_;
+    int type_ = -1;
+    std::vector<cv::Mat> buffers_;
+};
+
+}  // namespace performance
+
+#endif  // FRAME_POOL_H
@@ -0,0 +1,270 @@
+/**
+ * @file glyph_atlas.h
+ * @brief Cached text rendering from a packed glyph atlas
+ * @author Chethana G
+ * @date 2026-10-19
+ *
+ * cv::putText re-rasterizes the Hershey strokes of every character on every
+ * call. GlyphAtlas rasterizes each glyph once per font face, scale and
+ * thickness into an 8-bit coverage atlas and draws text by alpha-blending
+ * the cached coverage into the image, which is a few table lookups and one
+ * blend per covered pixel.
+ */
+
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <string>
+#include <tuple>
+#include <opencv2/opencv.hpp>
+#include "memory_accounting.h"
+
+namespace doodle {
+
+/**
+ * @class GlyphAtlas
+ * @brief Glyph cache that draws text like cv::putText with LINE_AA
+ *
+ * Glyphs are packed into one atlas per font on shelves, in the order they are
+ * first used. Pen positions are rounded to whole pixels, so text can differ
+ * from cv::putText by up to half a pixel per glyph.
+ */
+class GlyphAtlas {
+public:
+    /**
+     * @brief Draw text onto an image
+     *
+     * Same parameters as cv::putText. Images other than CV_8UC3 fall back to
+     * cv::putText.
+     * @param img Target image
+     * @param text ASCII text (other characters are drawn as '?')
+     * @param org Bottom-left corner of the text (baseline)
+     * @param fontFace Hershey font face
+     * @param fontScale Font scale
+     * @param color Text color
+     * @param thickness Stroke thickness
+     */
+    void drawText(cv::Mat& img, const char* text, cv::Point org, int fontFace,
+                  double fontScale, const cv::Scalar& color, int thickness = 1) {
+        if (img.type() != CV_8UC3) {
+            cv::putText(img, text, org, fontFace, fontScale, color, thickness, cv::LINE_AA);
+            return;
+        }
+        Face& face = findFace(fontFace, fontScale, thickness);
+        double penX = org.x;
+        for (const char* ch = text; *ch; ch++) {
+            const Glyph& glyph = findGlyph(face, *ch);
+            if (!glyph.rect.empty()) {
+                cv::Point at(cvRound(penX) + glyph.offset.x, org.y + glyph.offset.y);
+                blend(img, face.atlas(glyph.rect), at, color);
+            }
+            penX += glyph.advance;
+        }
+    }
+
+    void drawText(cv::Mat& img, const std::string& text, cv::Point org, int fontFace,
+                  double fontScale, const cv::Scalar& color, int thickness = 1) {
+        drawText(img, text.c_str(), org, fontFace, fontScale, color, thickness);
+    }
+
+    /**
+     * @brief Advance width of text in pixels
+     */
+    int textWidth(const std::string& text, int fontFace, double fontScale, int thickness = 1) {
+        Face& face = findFace(fontFace, fontScale, thickness);
+        double width = 0;
+        for (char ch : text) {
+            width += findGlyph(face, ch).advance;
+        }
+        return cvRound(width);
+    }
+
+    /**
+     * @brief Height above and below the baseline, as from cv::getTextSize
+     * @param fontFace Hershey font face
+     * @param fontScale Font scale
+     * @param thickness Stroke thickness
+     * @param baseline Set to the height below the baseline
+     * @return Height above the baseline
+     */
+    int ascent(int fontFace, double fontScale, int thickness, int* baseline = nullptr) {
+        Face& face = findFace(fontFace, fontScale, thickness);
+        if (baseline) *baseline = face.descent;
+        return face.ascent;
+    }
+
+    /**
+     * @brief Number of glyphs rasterized so far, over all fonts
+     */
+    size_t glyphCount() const { return rasterized_; }
+
+    /**
+     * @brief Bytes held by all atlases
+     */
+    size_t atlasBytes() const {
+        size_t bytes = 0;
+        for (const auto& entry : faces_) {
+            bytes += entry.second.atlas.total();
+        }
+        return bytes;
+    }
+
+    /**
+     * @brief Drop every cached glyph
+     */
+    void clear() {
+        faces_.clear();
+        rasterized_ = 0;
+    }
+
+private:
+    static constexpr int FIRST_CHAR = 32;
+    static constexpr int LAST_CHAR = 126;
+    static constexpr int ATLAS_WIDTH = 256;
+
+    struct Glyph {
+        bool ready = false;
+        cv::Rect rect;      ///< Coverage in the atlas, empty for blank glyphs
+        cv::Point offset;   ///< Top-left of rect relative to the pen on the baseline
+        double advance = 0;
+    };
+
+    struct Face {
+        int fontFace = 0;
+        double fontScale = 1.0;
+        int thickness = 1;
+        int ascent = 0;
+        int descent = 0;
+        cv::Mat atlas;       ///< CV_8UC1 coverage
+        cv::Point cursor;    ///< Next free position on the current shelf
+        int shelfHeight = 0;
+        std::array<Glyph, LAST_CHAR - FIRST_CHAR + 1> glyphs;
+    };
+
+    using FaceKey = std::tuple<int, int, int>;
+
+    Face& findFace(int fontFace, double fontScale, int thickness) {
+        // Scales closer than 1/1000 share a cache entry
+        FaceKey key(fontFace, cvRound(fontScale * 1000), thickness);
+        auto it = faces_.find(key);
+        if (it != faces_.end()) {
+            return it->second;
+        }
+
+        Face& face = faces_[key];
+        face.fontFace = fontFace;
+        face.fontScale = fontScale;
+        face.thickness = thickness;
+        face.ascent = cv::getTextSize("Hg", fontFace, fontScale, thickness, &face.descent).height;
+        return face;
+    }
+
+    const Glyph& findGlyph(Face& face, char ch) {
+        int c = static_cast<unsigned char>(ch);
+        if (c < FIRST_CHAR || c > LAST_CHAR) c = '?';
+        Glyph& glyph = face.glyphs[c - FIRST_CHAR];
+        if (!glyph.ready) {
+            rasterize(face, static_cast<char>(c), glyph);
+        }
+        return glyph;
+    }
+
+    void rasterize(Face& face, char ch, Glyph& glyph) {
+        performance::ScopedMemoryTag tag(performance::MemoryTag::UI);
+
+        // Repeating the glyph makes the rounded width precise to 1/16 pixel
+        const int repeats = 16;
+        int width = cv::getTextSize(std::string(repeats, ch), face.fontFace, face.fontScale,
+                                    face.thickness, nullptr).width;
+        glyph.advance = std::max(0, width - face.thickness) / static_cast<double>(repeats);
+
+        // Hershey strokes can reach past the nominal box, so draw with a margin
+        int pad = face.thickness + cvCeil(8 * face.fontScale) + 2;
+        cv::Size box(cvCeil(glyph.advance) + 2 * pad, face.ascent + face.descent + 2 * pad);
+        if (scratch_.rows < box.height || scratch_.cols < box.width) {
+            scratch_.create(std::max(scratch_.rows, box.height),
+                            std::max(scratch_.cols, box.width), CV_8UC1);
+        }
+        cv::Mat canvas = scratch_(cv::Rect(cv::Point(), box));
+        canvas.setTo(cv::Scalar::all(0));
+        cv::Point origin(pad, pad + face.ascent);
+        cv::putText(canvas, std::string(1, ch), origin, face.fontFace, face.fontScale,
+                    cv::Scalar::all(255), face.thickness, cv::LINE_AA);
+
+        cv::Rect ink = cv::boundingRect(canvas);
+        glyph.ready = true;
+        rasterized_++;
+        if (ink.empty()) {
+            return;
+        }
+
+        // Shelf packing: start a new shelf when the current one is full
+        if (face.cursor.x + ink.width > ATLAS_WIDTH) {
+            face.cursor = cv::Point(0, face.cursor.y + face.shelfHeight);
+            face.shelfHeight = 0;
+        }
+        reserve(face, cv::Size(face.cursor.x + ink.width, face.cursor.y + ink.height));
+
+        glyph.rect = cv::Rect(face.cursor, ink.size());
+        glyph.offset = ink.tl() - origin;
+        canvas(ink).copyTo(face.atlas(glyph.rect));
+        face.cursor.x += ink.width + 1;
+        face.shelfHeight = std::max(face.shelfHeight, ink.height + 1);
+    }
+
+    // Grow an atlas so that it covers the given size, keeping packed glyphs
+    static void reserve(Face& face, cv::Size needed) {
+        cv::Mat& atlas = face.atlas;
+        if (atlas.cols >= needed.width && atlas.rows >= needed.height) {
+            return;
+        }
+        int cols = std::max({atlas.cols, needed.width, ATLAS_WIDTH});
+        int rows = std::max({atlas.rows * 2, needed.height, 32});
+        cv::Mat grown(rows, cols, CV_8UC1, cv::Scalar::all(0));
+        if (!atlas.empty()) {
+            atlas.copyTo(grown(cv::Rect(0, 0, atlas.cols, atlas.rows)));
+        }
+        atlas = grown;
+    }
+
+    // Alpha-blend a solid color into a CV_8UC3 image through a coverage mask
+    static void blend(cv::Mat& img, const cv::Mat& coverage, cv::Point at,
+                      const cv::Scalar& color) {
+        cv::Rect dst = cv::Rect(at, coverage.size()) & cv::Rect(0, 0, img.cols, img.rows);
+        if (dst.empty()) return;
+        cv::Point src = dst.tl() - at;
+        const int b = cv::saturate_cast<uchar>(color[0]);
+        const int g = cv::saturate_cast<uchar>(color[1]);
+        const int r = cv::saturate_cast<uchar>(color[2]);
+
+        for (int y = 0; y < dst.height; y++) {
+            const uchar* a = coverage.ptr<uchar>(src.y + y) + src.x;
+            uchar* d = img.ptr<uchar>(dst.y + y) + dst.x * 3;
+            for (int x = 0; x < dst.width; x++, d += 3) {
+                int alpha = a[x];
+                if (alpha == 0) continue;
+                if (alpha == 255) {
+                    d[0] = static_cast<uchar>(b);
+                    d[1] = static_cast<uchar>(g);
+                    d[2] = static_cast<uchar>(r);
+                    continue;
+                }
+                int inv = 255 - alpha;
+                d[0] = static_cast<uchar>((d[0] * inv + b * alpha + 127) / 255);
+                d[1] = static_cast<uchar>((d[1] * inv + g * alpha + 127) / 255);
+                d[2] = static_cast<uchar>((d[2] * inv + r * alpha + 127) / 255);
+            }
+        }
+    }
+
+    std::map<FaceKey, Face> faces_;
+    cv::Mat scratch_;
+    size_t rasterized_ = 0;
+};
+
+}  // namespace doodle
+
+#endif  // GLYPH_ATLAS_H
@@ -0,0 +1,354 @@
+/**
+ * @file history.h
+ * @brief Undo/redo history that stores only the damaged region of each edit
+ * @author Chethana G
+ * @date 2026-10-19
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <utility>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+namespace doodle {
+
+/**
+ * @class History
+ * @brief Patch-based undo/redo
+ *
+ * History keeps one full copy of the canvas as of the last recorded edit
+ * (the base). Recording an edit stores the base pixels under the edit's
+ * damage rectangle and then brings the base up to date, so each undo level
+ * costs only the area that changed instead of a whole-canvas snapshot.
+ * Undo and redo swap the stored patch with the canvas in place.
+ *
+ * Each patch also masks the pixels its edit actually changed. Edits
+ * absorbed later (remote strokes) take their pixels out of every mask, so
+ * undoing or redoing a local edit puts back only what that edit drew and
+ * leaves a peer's stroke on top of it alone.
+ *
+ * Patches dropped when redo levels are discarded or the depth limit is hit
+ * are kept as spare buffers, and new patches are cut from them when one is
+ * large enough, so a steady drawing session stops allocating.
+ */
+class History {
+public:
+    /**
+     * @brief Pixels of a region as they were on the other side of an edit
+     */
+    struct Patch {
+        cv::Rect rect;
+        cv::Mat pixels;
+        // Names the current contents; undo and redo give the patch a new id,
+        // so a saved copy can be reused for as long as the id matches
+        uint64_t id = 0;
+        // CV_8UC1 of the rect size: pixels that undo and redo exchange. Empty
+        // means the whole rect, e.g. for levels reopened from a project,
+        // which does not store masks
+        cv::Mat mask;
+    };
+
+    /**
+     * @brief A patch id that has not been handed out before
+     */
+    static uint64_t nextId() {
+        static std::atomic<uint64_t> next{1};
+        return next++;
+    }
+
+    explicit History(size_t maxDepth = 20) : maxDepth_(maxDepth) { spare_.reserve(MAX_SPARE); }
+
+    /**
+     * @brief Forget all history and take the canvas as the new base
+     */
+    void reset(const cv::Mat& canvas) {
+        canvas.copyTo(base_);
+        undo_.clear();
+        redo_.clear();
+        spare_.clear();
+    }
+
+    /**
+     * @brief Record an edit as one undo level
+     * @param canvas Canvas after the edit
+     * @param damage Region the edit changed
+     */
+    void record(const cv::Mat& canvas, const cv::Rect& damage) {
+        cv::Rect rect = clip(canvas, damage);
+        if (rect.empty()) return;
+        ensureBase(canvas);
+
+        cv::Mat pixels = acquire(rect.size(), canvas.type());
+        base_(rect).copyTo(pixels);
+        undo_.push_back(Patch{rect, pixels, nextId(), changed(base_(rect), canvas(rect))});
+        canvas(rect).copyTo(base_(rect));
+        while (!redo_.empty()) {
+            recycle(redo_.back().pixels);
+            redo_.pop_back();
+        }
+        while (undo_.size() > maxDepth_) {
+            recycle(undo_.front().pixels);
+            undo_.pop_front();
+        }
+    }
+
+    /**
+     * @brief Accept an edit without making it undoable
+     *
+     * Used for strokes from remote peers, so that a later local undo does not
+     * wipe them out.
+     */
+    void absorb(const cv::Mat& canvas, const cv::Rect& damage) {
+        cv::Rect rect = clip(canvas, damage);
+        if (rect.empty()) return;
+        ensureBase(canvas);
+        release(canvas, rect);
+        canvas(rect).copyTo(base_(rect));
+    }
+
+    /**
+     * @brief Put back the last recorded state of a region
+     *
+     * Used to roll back a cancelled stroke.
+     */
+    void revert(cv::Mat& canvas, const cv::Rect& damage) const {
+        cv::Rect rect = clip(canvas, damage);
+        if (rect.empty() || base_.size() != canvas.size()) return;
+        base_(rect).copyTo(canvas(rect));
+    }
+
+    /**
+     * @brief The canvas as of the last recorded or absorbed edit
+     */
+    const cv::Mat& base() const { return base_; }
+
+    /**
+     * @brief Undo the last edit
+     * @param canvas Canvas to modify
+     * @param damage Set to the region that changed
+     * @return False if there was nothing to undo
+     */
+    bool undo(cv::Mat& canvas, cv::Rect& damage) { return step(undo_, redo_, canvas, damage); }
+
+    /**
+     * @brief Redo the last undone edit
+     * @param canvas Canvas to modify
+     * @param damage Set to the region that changed
+     * @return False if there was nothing to redo
+     */
+    bool redo(cv::Mat& canvas, cv::Rect& damage) { return step(redo_, undo_, canvas, damage); }
+
+    /**
+     * @brief Free a spare buffer, or else drop the oldest undo level (or redo
+     *        level if there are none)
+     * @return False if history is empty
+     */
+    bool trimOldest() {
+        if (!spare_.empty()) {
+            spare_.pop_back();
+        } else if (!undo_.empty()) {
+            undo_.pop_front();
+        } else if (!redo_.empty()) {
+            redo_.pop_front();
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Replace the undo and redo levels, keeping the base
+     *
+     * Used when reopening a saved project. Patches are checked against the
+     * base like undo() and redo() check them against the canvas. Levels
+     * beyond a patch that does not fit could never be reached in order, so
+     * they are dropped together with it.
+     * @return Number of levels dropped because a patch did not fit
+     */
+    size_t restore(std::deque<Patch> undo, std::deque<Patch> redo) {
+        size_t dropped = dropUnreachable(undo) + dropUnreachable(redo);
+        for (auto* levels : {&undo, &redo}) {
+            for (Patch& patch : *levels) {
+                if (patch.id == 0) patch.id = nextId();
+            }
+        }
+        undo_ = std::move(undo);
+        redo_ = std::move(redo);
+        while (undo_.size() > maxDepth_) {
+            undo_.pop_front();
+        }
+        return dropped;
+    }
+
+    const std::deque<Patch>& undoPatches() const { return undo_; }
+    const std::deque<Patch>& redoPatches() const { return redo_; }
+
+    void setMaxDepth(size_t depth) { maxDepth_ = std::max<size_t>(depth, 1); }
+    size_t undoDepth() const { return undo_.size(); }
+    size_t redoDepth() const { return redo_.size(); }
+
+private:
+    static cv::Rect clip(const cv::Mat& canvas, const cv::Rect& rect) {
+        return rect & cv::Rect(0, 0, canvas.cols, canvas.rows);
+    }
+
+    // Whether a patch can be swapped into the canvas
+    static bool fits(const Patch& patch, const cv::Mat& canvas) {
+        return !patch.rect.empty() && clip(canvas, patch.rect) == patch.rect &&
+               patch.pixels.type() == canvas.type() && patch.pixels.size() == patch.rect.size() &&
+               (patch.mask.empty() || patch.mask.size() == patch.rect.size());
+    }
+
+    // Levels are used from the back; drop everything up to the last misfit
+    size_t dropUnreachable(std::deque<Patch>& levels) const {
+        size_t keepFrom = 0;
+        for (size_t i = 0; i < levels.size(); i++) {
+            if (base_.empty() || !fits(levels[i], base_)) keepFrom = i + 1;
+        }
+        levels.erase(levels.begin(), levels.begin() + keepFrom);
+        return keepFrom;
+    }
+
+    void ensureBase(const cv::Mat& canvas) {
+        if (base_.size() != canvas.size() || base_.type() != canvas.type()) {
+            base_.create(canvas.size(), canvas.type());
+            base_.setTo(cv::Scalar::all(0));
+        }
+    }
+
+    // Smallest spare buffer that holds size, or a new one
+    cv::Mat acquire(cv::Size size, int type) {
+        size_t best = spare_.size();
+        for (size_t i = 0; i < spare_.size(); i++) {
+            const cv::Mat& m = spare_[i];
+            if (m.type() == type && m.cols >= size.width && m.rows >= size.height &&
+                (best == spare_.size() || m.total() < spare_[best].total())) {
+                best = i;
+            }
+        }
+        if (best == spare_.size()) {
+            return cv::Mat(size, type);
+        }
+        cv::Mat buffer = spare_[best];
+        std::swap(spare_[best], spare_.back());
+        spare_.pop_back();
+        return buffer(cv::Rect(0, 0, size.width, size.height));
+    }
+
+    // Keep the whole buffer behind a dropped patch, unless someone else holds it
+    void recycle(cv::Mat& pixels) {
+        if (pixels.empty() || !pixels.u || pixels.u->refcount != 1) return;
+        cv::Size whole;
+        cv::Point offset;
+        pixels.locateROI(whole, offset);
+        pixels.adjustROI(offset.y, whole.height - pixels.rows - offset.y, offset.x,
+                         whole.width - pixels.cols - offset.x);
+        if (spare_.size() >= MAX_SPARE) {
+            spare_.erase(spare_.begin());
+        }
+        spare_.push_back(pixels);
+    }
+
+    bool step(std::deque<Patch>& from, std::deque<Patch>& to, cv::Mat& canvas,
+              cv::Rect& damage) {
+        damage = cv::Rect();
+        if (from.empty()) return false;
+        // Keep a patch that does not fit (the canvas changed size or format
+        // since the edit) rather than losing the level
+        if (!fits(from.back(), canvas)) return false;
+        Patch entry = from.back();
+        from.pop_back();
+
+        ensureBase(canvas);
+        damage = entry.rect;
+        swapPixels(canvas(damage), entry.pixels, entry.mask);
+        entry.id = nextId();
+        if (entry.mask.empty()) {
+            canvas(damage).copyTo(base_(damage));
+        } else {
+            canvas(damage).copyTo(base_(damage), entry.mask);
+        }
+        to.push_back(entry);
+        return true;
+    }
+
+    // Exchange two equally sized regions row by row, without a temporary Mat;
+    // with a mask, only the pixels it selects
+    static void swapPixels(cv::Mat a, cv::Mat b, const cv::Mat& mask) {
+        size_t pixelBytes = a.elemSize();
+        size_t rowBytes = a.cols * pixelBytes;
+        for (int y = 0; y < a.rows; y++) {
+            uchar* p = a.ptr<uchar>(y);
+            uchar* q = b.ptr<uchar>(y);
+            if (mask.empty()) {
+                std::swap_ranges(p, p + rowBytes, q);
+                continue;
+            }
+            const uchar* m = mask.ptr<uchar>(y);
+            for (int x = 0; x < a.cols; x++) {
+                if (m[x]) std::swap_ranges(p + x * pixelBytes, p + (x + 1) * pixelBytes,
+                                           q + x * pixelBytes);
+            }
+        }
+    }
+
+    // Mask of the pixels that differ between two equally sized regions
+    static cv::Mat changed(const cv::Mat& before, const cv::Mat& after) {
+        cv::Mat mask(before.size(), CV_8UC1);
+        size_t pixelBytes = before.elemSize();
+        for (int y = 0; y < before.rows; y++) {
+            const uchar* p = before.ptr<uchar>(y);
+            const uchar* q = after.ptr<uchar>(y);
+            uchar* m = mask.ptr<uchar>(y);
+            for (int x = 0; x < before.cols; x++) {
+                m[x] = std::memcmp(p + x * pixelBytes, q + x * pixelBytes, pixelBytes) ? 255 : 0;
+            }
+        }
+        return mask;
+    }
+
+    // Pixels an absorbed edit changes belong to it from now on: take them out
+    // of the mask of every level, before the base takes them
+    void release(const cv::Mat& source, const cv::Rect& rect) {
+        size_t pixelBytes = base_.elemSize();
+        for (auto* levels : {&undo_, &redo_}) {
+            for (Patch& patch : *levels) {
+                cv::Rect overlap = patch.rect & rect;
+                if (overlap.empty()) continue;
+                if (patch.mask.empty()) {
+                    patch.mask = cv::Mat(patch.rect.size(), CV_8UC1, cv::Scalar(255));
+                }
+                for (int y = overlap.y; y < overlap.y + overlap.height; y++) {
+                    const uchar* now = source.ptr<uchar>(y);
+                    const uchar* then = base_.ptr<uchar>(y);
+                    uchar* keep = patch.mask.ptr<uchar>(y - patch.rect.y);
+                    for (int x = overlap.x; x < overlap.x + overlap.width; x++) {
+                        size_t offset = x * pixelBytes;
+                        if (std::memcmp(now + offset, then + offset, pixelBytes) != 0) {
+                            keep[x - patch.rect.x] = 0;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    static constexpr size_t MAX_SPARE = 8;
+
+    size_t maxDepth_;
+    cv::Mat base_;
+    std::vector<cv::Mat> spare_;
+    std::deque<Patch> undo_;
+    std::deque<Patch> redo_;
+};
+
+}  // namespace doodle
+
+#endif  // HISTORY_H
@@ -0,0 +1,114 @@
+/**
+ * @file input_recorder.h
+ * @brief Recording and replay of mouse input for headless runs
+ * @author Chethana G
+ * @date 2026-10-19
+ *
+ * Events are stored one per line as "frame event x y flags", where frame is
+ * the index of the loop iteration that received the event and x/y are frame
+ * coordinates (the preview scale is already undone, the scene anchor is not).
+ * Replaying a recording against the same video reproduces the session
+ * without a window, because the anchor is recomputed from the same frames.
+ */
+
+#ifndef INPUT_RECORDER_H
+#define INPUT_RECORDER_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @struct RecordedInput
+ * @brief One mouse event tagged with the frame it arrived in
+ */
+struct RecordedInput {
+    uint64_t frame = 0;
+    int event = 0;
+    int x = 0;
+    int y = 0;
+    int flags = 0;
+};
+
+/**
+ * @class InputRecorder
+ * @brief Appends mouse events to a text file
+ */
+class InputRecorder {
+public:
+    /**
+     * @brief Start recording to a file
+     * @param filename Output path (truncated)
+     * @return True if the file could be opened
+     */
+    bool open(const std::string& filename) {
+        out_.open(filename, std::ios::out | std::ios::trunc);
+        return out_.is_open();
+    }
+
+    bool isOpen() const { return out_.is_open(); }
+
+    /**
+     * @brief Record one event
+     */
+    void record(const RecordedInput& input) {
+        if (!out_.is_open()) return;
+        out_ << input.frame << ' ' << input.event << ' ' << input.x << ' ' << input.y << ' '
+             << input.flags << '\n';
+    }
+
+private:
+    std::ofstream out_;
+};
+
+/**
+ * @class InputReplayer
+ * @brief Feeds recorded mouse events back, frame by frame
+ */
+class InputReplayer {
+public:
+    InputReplayer() : next_(0) {}
+
+    /**
+     * @brief Load a recording
+     * @param filename Path written by InputRecorder
+     * @return False if the file could not be read
+     */
+    bool load(const std::string& filename) {
+        std::ifstream in(filename);
+        if (!in.is_open()) return false;
+        events_.clear();
+        next_ = 0;
+        RecordedInput input;
+        while (in >> input.frame >> input.event >> input.x >> input.y >> input.flags) {
+            events_.push_back(input);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Dispatch every event recorded up to and including a frame
+     * @param frame Current frame index
+     * @param dispatch Callable taking a const RecordedInput&
+     * @return Number of events dispatched
+     */
+    template <typename Dispatch>
+    size_t replay(uint64_t frame, Dispatch&& dispatch) {
+        size_t count = 0;
+        while (next_ < events_.size() && events_[next_].frame <= frame) {
+            dispatch(events_[next_++]);
+            count++;
+        }
+        return count;
+    }
+
+    bool isLoaded() const { return !events_.empty(); }
+    bool finished() const { return next_ >= events_.size(); }
+
+private:
+    std::vector<RecordedInput> events_;
+    size_t next_;
+};
+
+#endif  // INPUT_RECORDER_H
@@ -0,0 +1,253 @@
+/**
+ * @file latency_tracker.h
+ * @brief Input-to-display and capture-to-display latency measurement
+ * @author Chethana G
+ * @date 2026-10-19
+ *
+ * FPSCounter only measures the loop period. What users feel is how long it
+ * takes for ink to appear after the mouse moves, so every input that changes
+ * canvas pixels is followed through rasterization, compositing and display:
+ *
+ *   input ──► rasterized ──► composited ──► displayed
+ *   (mouseCallback entry)    (addWeighted)  (imshow)
+ *
+ * Captured frames are followed from acquisition to display the same way.
+ */
+
+#ifndef LATENCY_TRACKER_H
+#define LATENCY_TRACKER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "overlay_text.h"
+
+namespace performance {
+
+/**
+ * @class LatencyHistogram
+ * @brief Keeps the most recent latency samples and reports percentiles
+ */
+class LatencyHistogram {
+public:
+    explicit LatencyHistogram(size_t capacity = 4096)
+        : capacity_(capacity), next_(0), total_(0), sortedTotal_(0) {
+        samples_.reserve(capacity_);
+        sorted_.reserve(capacity_);
+    }
+
+    /**
+     * @brief Add a sample
+     * @param ms Latency in milliseconds
+     */
+    void add(double ms) {
+        if (samples_.size() < capacity_) {
+            samples_.push_back(ms);
+        } else {
+            samples_[next_] = ms;
+            next_ = (next_ + 1) % capacity_;
+        }
+        total_++;
+    }
+
+    /**
+     * @brief Get a percentile of the retained samples
+     *
+     * The samples are sorted once after new ones arrive, so asking for
+     * several percentiles in a row costs one sort.
+     * @param p Percentile in [0, 100]
+     * @return Latency in milliseconds, 0 if there are no samples
+     */
+    double percentile(double p) const {
+        if (samples_.empty()) return 0.0;
+        if (sortedTotal_ != total_) {
+            sorted_ = samples_;
+            std::sort(sorted_.begin(), sorted_.end());
+            sortedTotal_ = total_;
+        }
+        size_t rank = static_cast<size_t>(p / 100.0 * (sorted_.size() - 1) + 0.5);
+        return sorted_[std::min(rank, sorted_.size() - 1)];
+    }
+
+    double max() const {
+        return samples_.empty() ? 0.0 : *std::max_element(samples_.begin(), samples_.end());
+    }
+
+    size_t count() const { return total_; }
+
+    void clear() {
+        samples_.clear();
+        next_ = 0;
+        total_ = 0;
+        sortedTotal_ = 0;
+    }
+
+private:
+    size_t capacity_;
+    size_t next_;
+    size_t total_;
+    mutable size_t sortedTotal_;  ///< total_ when sorted_ was last rebuilt
+    std::vector<double> samples_;
+    mutable std::vector<double> sorted_;
+};
+
+/**
+ * @class LatencyTracker
+ * @brief Follows drawing inputs and camera frames to the display
+ *
+ * Typical use in the main loop:
+ * @code
+ *   camera >> frame;          tracker.markCapture();
+ *   // mouse callback:        tracker.addInput(entryTime) after drawing
+ *   addWeighted(...);         tracker.markComposited();
+ *   imshow(...);              tracker.markDisplayed();
+ * @endcode
+ */
+class LatencyTracker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    LatencyTracker()
+        : captureValid_(false), compositeValid_(false), overlayInput_(0.0),
+          overlayCapture_(0.0) {
+        pending_.reserve(256);
+    }
+
+    static Clock::time_point now() { return Clock::now(); }
+
+    /**
+     * @brief Record a drawing input that has just been rasterized
+     * @param inputTime Timestamp taken at mouseCallback entry
+     */
+    void addInput(Clock::time_point inputTime) {
+        pending_.push_back(InputEvent{inputTime, Clock::now(), Clock::time_point(), false});
+    }
+
+    /**
+     * @brief Mark that a camera frame has just been acquired
+     */
+    void markCapture() {
+        captureTime_ = Clock::now();
+        captureValid_ = true;
+    }
+
+    /**
+     * @brief Mark that canvas and frame have been composited
+     *
+     * Every input rasterized so far is part of this composite.
+     */
+    void markComposited() {
+        compositeTime_ = Clock::now();
+        compositeValid_ = true;
+        for (auto& event : pending_) {
+            if (!event.composited) {
+                event.compositedAt = compositeTime_;
+                event.composited = true;
+            }
+        }
+    }
+
+    /**
+     * @brief Mark that the composited frame has been handed to the display
+     */
+    void markDisplayed() {
+        auto displayTime = Clock::now();
+        if (!compositeValid_) return;
+
+        size_t kept = 0;
+        for (auto& event : pending_) {
+            if (!event.composited) {
+                pending_[kept++] = event;
+                continue;
+            }
+            inputToRaster_.add(toMs(event.rasterizedAt - event.inputAt));
+            inputToComposite_.add(toMs(event.compositedAt - event.inputAt));
+            inputToDisplay_.add(toMs(displayTime - event.inputAt));
+        }
+        pending_.resize(kept);
+
+        if (captureValid_) {
+            captureToDisplay_.add(toMs(displayTime - captureTime_));
+            captureValid_ = false;
+        }
+        compositeValid_ = false;
+    }
+
+    const LatencyHistogram& inputToDisplay() const { return inputToDisplay_; }
+    const LatencyHistogram& captureToDisplay() const { return captureToDisplay_; }
+
+    /**
+     * @brief Print latency distributions
+     * @param out Output stream
+     */
+    void report(std::ostream& out) const {
+        out << "Latency (ms)            samples     p50     p95     p99     max" << std::endl;
+        reportLine(out, "input -> rasterized", inputToRaster_);
+        reportLine(out, "input -> composited", inputToComposite_);
+        reportLine(out, "input -> displayed", inputToDisplay_);
+        reportLine(out, "capture -> displayed", captureToDisplay_);
+    }
+
+    /**
+     * @brief Draw median input and capture latency on image
+     *
+     * A capture sample arrives every frame, so the medians are recomputed
+     * a few times per second rather than on every call.
+     * @param img Target image
+     * @param position Text position
+     */
+    void drawOverlay(cv::Mat& img, cv::Point position = cv::Point(10, 150)) const {
+        auto current = Clock::now();
+        if (current - overlayUpdated_ >= OVERLAY_REFRESH) {
+            overlayInput_ = inputToDisplay_.percentile(50);
+            overlayCapture_ = captureToDisplay_.percentile(50);
+            overlayUpdated_ = current;
+        }
+        char text[96];
+        std::snprintf(text, sizeof(text), "Latency p50: input %.1fms | capture %.1fms",
+                      overlayInput_, overlayCapture_);
+        drawOverlayText(img, text, position, 0.5, cv::Scalar(0, 255, 0), 1);
+    }
+
+private:
+    static constexpr std::chrono::milliseconds OVERLAY_REFRESH{250};
+
+    struct InputEvent {
+        Clock::time_point inputAt;
+        Clock::time_point rasterizedAt;
+        Clock::time_point compositedAt;
+        bool composited;
+    };
+
+    static double toMs(Clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+
+    static void reportLine(std::ostream& out, const char* name, const LatencyHistogram& h) {
+        char line[128];
+        std::snprintf(line, sizeof(line), "%-22s %9zu %7.2f %7.2f %7.2f %7.2f", name, h.count(),
+                      h.percentile(50), h.percentile(95), h.percentile(99), h.max());
+        out << line << std::endl;
+    }
+
+    std::vector<InputEvent> pending_;
+    Clock::time_point captureTime_;
+    Clock::time_point compositeTime_;
+    bool captureValid_;
+    bool compositeValid_;
+    LatencyHistogram inputToRaster_;
+    LatencyHistogram inputToComposite_;
+    LatencyHistogram inputToDisplay_;
+    LatencyHistogram captureToDisplay_;
+    mutable Clock::time_point overlayUpdated_;
+    mutable double overlayInput_;
+    mutable double overlayCapture_;
+};
+
+}  // namespace performance
+
+#endif  // LATENCY_TRACKER_H
@@ -0,0 +1,262 @@
+/**
+ * @file memory_accounting.h
+ * @brief Per-subsystem accounting of cv::Mat memory with enforced budgets
+ * @author Chethana G
+ * @date 2026-10-19
+ *
+ * TrackingMatAllocator replaces OpenCV's default allocator and charges every
+ * Mat buffer to the subsystem that was active when it was created:
+ *
+ * @code
+ *   {
+ *       ScopedMemoryTag tag(MemoryTag::History);
+ *       history.record(canvas, damage);   // the undo patch counts as history
+ *   }
+ * @endcode
+ *
+ * The tag is remembered with the buffer, so it is released against the same
+ * subsystem no matter where the last reference goes away. Budgets are checked
+ * once per frame by MemoryAccountant::enforceBudgets(), which calls the
+ * eviction handler of every subsystem that is over its limit. A subsystem
+ * without a handler is warn-only: going over its budget only marks it with
+ * "!" in the overlay. In live_doodle that is the case for the canvas and
+ * export budgets, because neither holds anything that could be dropped.
+ *
+ * Every buffer is also counted by AllocationCounter, which is how the frame
+ * loop checks that it runs without allocating.
+ */
+
+#ifndef MEMORY_ACCOUNTING_H
+#define MEMORY_ACCOUNTING_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <opencv2/opencv.hpp>
+#include "allocation_counter.h"
+#include "overlay_text.h"
+
+namespace performance {
+
+/**
+ * @brief Subsystems that memory is charged to
+ */
+enum class MemoryTag : int {
+    Untagged = 0,  ///< Anything not created under a ScopedMemoryTag
+    Canvas,        ///< Drawing layer
+    History,       ///< Undo/redo patches and the history base
+    Preview,       ///< Shape-tool previews, tracking buffers and the scaled display preview
+    UI,            ///< Overlay and HUD caches
+    Export,        ///< Frames queued for saving or streaming
+    Count
+};
+
+/**
+ * @brief Short name of a memory tag
+ */
+inline const char* memoryTagName(MemoryTag tag) {
+    static const char* const names[] = {"other", "canvas", "history", "preview", "ui", "export"};
+    int index = static_cast<int>(tag);
+    return (index >= 0 && index < static_cast<int>(MemoryTag::Count)) ? names[index] : "?";
+}
+
+/**
+ * @class MemoryAccountant
+ * @brief Live byte counts and budgets per subsystem
+ */
+class MemoryAccountant {
+public:
+    static constexpr int TAG_COUNT = static_cast<int>(MemoryTag::Count);
+
+    static void charge(MemoryTag tag, size_t bytes) {
+        bytes_[index(tag)].fetch_add(static_cast<int64_t>(bytes), std::memory_order_relaxed);
+        allocations_[index(tag)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void release(MemoryTag tag, size_t bytes) {
+        bytes_[index(tag)].fetch_sub(static_cast<int64_t>(bytes), std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Bytes currently held by a subsystem
+     */
+    static int64_t bytes(MemoryTag tag) {
+        return bytes_[index(tag)].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Number of buffers ever allocated for a subsystem
+     */
+    static uint64_t allocations(MemoryTag tag) {
+        return allocations_[index(tag)].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Set a subsystem's budget
+     * @param tag Subsystem
+     * @param bytes Maximum bytes, 0 for unlimited
+     */
+    static void setBudget(MemoryTag tag, int64_t bytes) { budgets_[index(tag)] = bytes; }
+
+    static int64_t budget(MemoryTag tag) { return budgets_[index(tag)]; }
+
+    static bool overBudget(MemoryTag tag) {
+        int64_t limit = budgets_[index(tag)];
+        return limit > 0 && bytes(tag) > limit;
+    }
+
+    /**
+     * @brief Register the function that frees memory for a subsystem
+     *
+     * Without a handler the subsystem's budget is warn-only.
+     * @param tag Subsystem
+     * @param evict Called while the subsystem is over budget; must free
+     *              something or return false if nothing is left to evict
+     */
+    static void setEvictionHandler(MemoryTag tag, std::function<bool()> evict) {
+        evictors_[index(tag)] = std::move(evict);
+    }
+
+    /**
+     * @brief Evict from every subsystem that is over its budget
+     * @return Number of evictions performed
+     */
+    static int enforceBudgets() {
+        int evictions = 0;
+        for (int i = 0; i < TAG_COUNT; i++) {
+            MemoryTag tag = static_cast<MemoryTag>(i);
+            while (overBudget(tag) && evictors_[i] && evictors_[i]()) {
+                evictions++;
+            }
+        }
+        return evictions;
+    }
+
+    /**
+     * @brief Draw per-subsystem usage on image
+     * @param img Target image
+     * @param position Text position
+     */
+    static void drawOverlay(cv::Mat& img, cv::Point position = cv::Point(10, 180)) {
+        char text[160];
+        int len = std::snprintf(text, sizeof(text), "Mem MB:");
+        for (int i = 1; i < TAG_COUNT && len < static_cast<int>(sizeof(text)); i++) {
+            MemoryTag tag = static_cast<MemoryTag>(i);
+            len += std::snprintf(text + len, sizeof(text) - len, " %s %.1f%s", memoryTagName(tag),
+                                 bytes(tag) / (1024.0 * 1024.0), overBudget(tag) ? "!" : "");
+        }
+        drawOverlayText(img, text, position, 0.5, cv::Scalar(255, 255, 0), 1);
+    }
+
+private:
+    static int index(MemoryTag tag) { return static_cast<int>(tag); }
+
+    static inline std::array<std::atomic<int64_t>, TAG_COUNT> bytes_{};
+    static inline std::array<std::atomic<uint64_t>, TAG_COUNT> allocations_{};
+    static inline std::array<int64_t, TAG_COUNT> budgets_{};
+    static inline std::array<std::function<bool()>, TAG_COUNT> evictors_{};
+};
+
+/**
+ * @class ScopedMemoryTag
+ * @brief Charges Mats created on this thread to a subsystem while in scope
+ */
+class ScopedMemoryTag {
+public:
+    explicit ScopedMemoryTag(MemoryTag tag) : previous_(current()) { current() = tag; }
+    ~ScopedMemoryTag() { current() = previous_; }
+
+    ScopedMemoryTag(const ScopedMemoryTag&) = delete;
+    ScopedMemoryTag& operator=(const ScopedMemoryTag&) = delete;
+
+    /**
+     * @brief Tag that new allocations on this thread are charged to
+     */
+    static MemoryTag& current() {
+        thread_local MemoryTag tag = MemoryTag::Untagged;
+        return tag;
+    }
+
+private:
+    MemoryTag previous_;
+};
+
+/**
+ * @class TrackingMatAllocator
+ * @brief cv::MatAllocator that charges buffers to the current memory tag
+ *
+ * Allocation follows OpenCV's standard allocator; the tag is kept in
+ * UMatData::userdata so the release is charged to the same subsystem.
+ */
+class TrackingMatAllocator : public cv::MatAllocator {
+public:
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data0, size_t* step,
+                           cv::AccessFlag /*flags*/,
+                           cv::UMatUsageFlags /*usageFlags*/) const override {
+        size_t total = CV_ELEM_SIZE(type);
+        for (int i = dims - 1; i >= 0; i--) {
+            if (step) {
+                if (data0 && step[i] != cv::Mat::AUTO_STEP && step[i] != CV_AUTO_STEP) {
+                    CV_Assert(total <= step[i]);
+                    total = step[i];
+                } else {
+                    step[i] = total;
+                }
+            }
+            total *= sizes[i];
+        }
+
+        unsigned char* data = static_cast<unsigned char*>(data0 ? data0 : cv::fastMalloc(total));
+        cv::UMatData* u = new cv::UMatData(this);
+        u->data = u->origdata = data;
+        u->size = total;
+        if (data0) {
+            u->flags |= cv::UMatData::USER_ALLOCATED;
+        } else {
+            MemoryTag tag = ScopedMemoryTag::current();
+            u->userdata = reinterpret_cast<void*>(static_cast<intptr_t>(tag));
+            MemoryAccountant::charge(tag, total);
+            AllocationCounter::countMat(total);
+        }
+        return u;
+    }
+
+    bool allocate(cv::UMatData* u, cv::AccessFlag /*accessFlags*/,
+                  cv::UMatUsageFlags /*usageFlags*/) const override {
+        return u != nullptr;
+    }
+
+    void deallocate(cv::UMatData* u) const override {
+        if (!u) return;
+        CV_Assert(u->urefcount == 0);
+        CV_Assert(u->refcount == 0);
+        if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+            MemoryTag tag = static_cast<MemoryTag>(reinterpret_cast<intptr_t>(u->userdata));
+            MemoryAccountant::release(tag, u->size);
+            cv::fastFree(u->origdata);
+            u->origdata = nullptr;
+        }
+        delete u;
+    }
+
+    /**
+     * @brief Make this the default allocator for all new Mats
+     */
+    static void install() { cv::Mat::setDefaultAllocator(&instance()); }
+
+    static TrackingMatAllocator& instance() {
+        static TrackingMatAllocator allocator;
+        return allocator;
+    }
+
+private:
+    // CV_AUTOSTEP, the marker OpenCV's own allocator compares steps against;
+    // cv::Mat::AUTO_STEP is accepted as well
+    static constexpr size_t CV_AUTO_STEP = 0x7fffffff;
+};
+
+}  // namespace performance
+
+#endif  // MEMORY_ACCOUNTING_H
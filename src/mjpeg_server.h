@@ -0,0 +1,433 @@
+/**
+ * @file mjpeg_server.h
+ * @brief Localhost MJPEG-over-HTTP preview of the composited output
+ * @author Chethana G
+ * @date 2026-10-19
+ *
+ * MjpegServer serves the annotated feed to browsers and tools such as curl
+ * as a multipart/x-mixed-replace stream. The render loop only hands frames
+ * over; a worker thread encodes each frame to JPEG once and sends the same
+ * buffer to every connected client.
+ *
+ * Each client holds at most the frame it is sending and the newest frame
+ * after it. A client that cannot keep up skips the frames in between, so
+ * neither slow clients nor the encoder ever hold up the render loop.
+ *
+ * @code
+ *   curl -s http://127.0.0.1:8090/ --output stream.mjpeg
+ * @endcode
+ *
+ * The server uses POSIX sockets; on Windows start() fails and the rest is a
+ * no-op.
+ */
+
+#ifndef MJPEG_SERVER_H
+#define MJPEG_SERVER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "memory_accounting.h"
+#include "overlay_text.h"
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace doodle {
+
+/**
+ * @class MjpegServer
+ * @brief Encode-once, fan-out MJPEG server bound to the loopback interface
+ */
+class MjpegServer {
+public:
+    /**
+     * @brief Server settings
+     */
+    struct Settings {
+        int port = 8090;
+        int quality = 80;     ///< JPEG quality, 0-100
+        int maxClients = 8;
+    };
+
+    MjpegServer() : listenFd_(-1), running_(false), hasJob_(false), streaming_(0),
+                    encoded_(0), skipped_(0), encodeMs_(0) {
+        wakeFds_[0] = wakeFds_[1] = -1;
+    }
+
+    ~MjpegServer() { stop(); }
+
+    MjpegServer(const MjpegServer&) = delete;
+    MjpegServer& operator=(const MjpegServer&) = delete;
+
+    /**
+     * @brief Listen on 127.0.0.1 and start the worker thread
+     * @return False if the port could not be bound or the platform has no
+     *         support (see error())
+     */
+    bool start(const Settings& settings) {
+        stop();
+        settings_ = settings;
+#ifdef _WIN32
+        return fail("MJPEG server is not supported on Windows");
+#else
+        listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+        if (listenFd_ < 0) return fail("cannot create socket");
+        int one = 1;
+        setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(settings_.port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(listenFd_, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(listenFd_, 8) != 0 || !setNonBlocking(listenFd_)) {
+            closeAll();
+            return fail("cannot listen on 127.0.0.1:" + std::to_string(settings_.port));
+        }
+        if (pipe(wakeFds_) != 0 || !setNonBlocking(wakeFds_[0]) ||
+            !setNonBlocking(wakeFds_[1])) {
+            closeAll();
+            return fail("cannot create wake-up pipe");
+        }
+
+        hasJob_ = false;
+        running_ = true;
+        worker_ = std::thread(&MjpegServer::run, this);
+        return true;
+#endif
+    }
+
+    /**
+     * @brief Stop the worker and disconnect all clients
+     */
+    void stop() {
+        if (running_.exchange(false)) {
+            wake();
+            if (worker_.joinable()) worker_.join();
+        }
+        closeAll();
+    }
+
+    bool isRunning() const { return running_; }
+
+    /**
+     * @brief Hand a frame to the encoder
+     *
+     * Copies the frame into a reused buffer and returns at once. Nothing is
+     * copied while no client is watching.
+     * @return False if the frame was not taken (no clients, or the encoder
+     *         still has the previous frame waiting)
+     */
+    bool submit(const cv::Mat& frame) {
+        if (!running_ || streaming_ == 0) return false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (hasJob_) {
+                skipped_++;
+                return false;
+            }
+            performance::ScopedMemoryTag tag(performance::MemoryTag::Export);
+            frame.copyTo(job_);
+            hasJob_ = true;
+        }
+        wake();
+        return true;
+    }
+
+    int clients() const { return streaming_; }
+    uint64_t encodedFrames() const { return encoded_; }
+    uint64_t skippedFrames() const { return skipped_; }
+    double encodeMs() const { return encodeMs_; }
+    int port() const { return settings_.port; }
+    const std::string& error() const { return error_; }
+
+    /**
+     * @brief Draw server statistics on image
+     * @param img Target image
+     * @param position Text position
+     */
+    void drawOverlay(cv::Mat& img, cv::Point position = cv::Point(10, 270)) const {
+        char text[96];
+        std::snprintf(text, sizeof(text), "MJPEG: %d clients | enc %.1fms | skipped %llu",
+                      clients(), encodeMs(), static_cast<unsigned long long>(skippedFrames()));
+        performance::drawOverlayText(img, text, position, 0.5, cv::Scalar(255, 255, 0), 1);
+    }
+
+private:
+    using Packet = std::shared_ptr<const std::vector<uchar>>;
+
+    struct Client {
+        int fd = -1;
+        std::string request;   ///< Request bytes until the header is complete
+        bool streaming = false;
+        bool closeWhenSent = false;
+        Packet sending;        ///< Packet being written
+        size_t offset = 0;
+        Packet next;           ///< Newest frame waiting behind it
+    };
+
+    static constexpr size_t MAX_REQUEST = 8192;
+    // Frames already handed to the kernel cannot be skipped; a small send
+    // buffer keeps a slow client's backlog here, where newer frames replace it
+    static constexpr int SEND_BUFFER = 64 * 1024;
+
+#ifndef _WIN32
+    void run() {
+        std::vector<pollfd> fds;
+        while (running_) {
+            fds.clear();
+            fds.push_back(pollfd{wakeFds_[0], POLLIN, 0});
+            bool accepting = static_cast<int>(clients_.size()) < settings_.maxClients;
+            fds.push_back(pollfd{accepting ? listenFd_ : -1, POLLIN, 0});
+            for (const Client& c : clients_) {
+                short events = POLLIN;
+                if (c.sending) events |= POLLOUT;
+                fds.push_back(pollfd{c.fd, events, 0});
+            }
+            if (::poll(fds.data(), fds.size(), 250) < 0 && errno != EINTR) break;
+
+            if (fds[0].revents & POLLIN) {
+                drainWake();
+                encodePending();
+            }
+            if (fds[1].revents & POLLIN) {
+                acceptPending();
+            }
+            // New clients were appended after the polled ones
+            for (size_t i = 0; i + 2 < fds.size(); i++) {
+                Client& c = clients_[i];
+                if (c.fd < 0) continue;  // dropped while encoding
+                if (fds[i + 2].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                    disconnect(c);
+                    continue;
+                }
+                if (fds[i + 2].revents & POLLIN) receive(c);
+                if (c.fd >= 0 && (fds[i + 2].revents & POLLOUT)) transmit(c);
+            }
+            clients_.erase(std::remove_if(clients_.begin(), clients_.end(),
+                                          [](const Client& c) { return c.fd < 0; }),
+                           clients_.end());
+            streaming_ = static_cast<int>(std::count_if(
+                clients_.begin(), clients_.end(), [](const Client& c) { return c.streaming; }));
+        }
+        for (Client& c : clients_) disconnect(c);
+        clients_.clear();
+        streaming_ = 0;
+    }
+
+    // Encode the waiting frame once and queue it for every streaming client
+    void encodePending() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!hasJob_) return;
+            cv::swap(job_, encoding_);
+            hasJob_ = false;
+        }
+        auto start = std::chrono::steady_clock::now();
+        cv::imencode(".jpg", encoding_, jpeg_, {cv::IMWRITE_JPEG_QUALITY, settings_.quality});
+        char header[96];
+        int headerLength = std::snprintf(header, sizeof(header),
+                                         "--frame\r\nContent-Type: image/jpeg\r\n"
+                                         "Content-Length: %zu\r\n\r\n", jpeg_.size());
+        auto packet = std::make_shared<std::vector<uchar>>();
+        packet->reserve(headerLength + jpeg_.size() + 2);
+        packet->insert(packet->end(), header, header + headerLength);
+        packet->insert(packet->end(), jpeg_.begin(), jpeg_.end());
+        packet->push_back('\r');
+        packet->push_back('\n');
+        encodeMs_ = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start).count();
+        encoded_++;
+
+        Packet shared = packet;
+        for (Client& c : clients_) {
+            if (!c.streaming) continue;
+            if (c.sending) {
+                c.next = shared;  // replaces any older waiting frame
+            } else {
+                c.sending = shared;
+                c.offset = 0;
+                transmit(c);
+            }
+        }
+    }
+
+    void acceptPending() {
+        while (static_cast<int>(clients_.size()) < settings_.maxClients) {
+            int fd = accept(listenFd_, nullptr, nullptr);
+            if (fd < 0) break;
+            if (!setNonBlocking(fd)) {
+                ::close(fd);
+                continue;
+            }
+            int sendBuffer = SEND_BUFFER;
+            setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+            Client c;
+            c.fd = fd;
+            clients_.push_back(std::move(c));
+        }
+    }
+
+    // Read the request header; once streaming, input is only watched for EOF
+    void receive(Client& c) {
+        char buffer[1024];
+        ssize_t n = recv(c.fd, buffer, sizeof(buffer), 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            disconnect(c);
+            return;
+        }
+        if (n < 0 || c.streaming || c.closeWhenSent) return;
+
+        c.request.append(buffer, static_cast<size_t>(n));
+        if (c.request.find("\r\n\r\n") == std::string::npos) {
+            if (c.request.size() > MAX_REQUEST) disconnect(c);
+            return;
+        }
+        bool stream = c.request.compare(0, 6, "GET / ") == 0 ||
+                      c.request.compare(0, 12, "GET /stream ") == 0;
+        if (stream) {
+            static const Packet header = text(
+                "HTTP/1.0 200 OK\r\n"
+                "Content-Type: multipart/x-mixed-replace; boundary=frame\r\n"
+                "Cache-Control: no-cache, no-store\r\n"
+                "Pragma: no-cache\r\n"
+                "Connection: close\r\n\r\n");
+            c.streaming = true;
+            c.sending = header;
+        } else {
+            static const Packet notFound = text(
+                "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\n"
+                "Connection: close\r\n\r\nThe stream is at /\r\n");
+            c.closeWhenSent = true;
+            c.sending = notFound;
+        }
+        c.offset = 0;
+        c.request.clear();
+        transmit(c);
+    }
+
+    // Write as much as the socket takes, then move on to the newest frame
+    void transmit(Client& c) {
+#ifdef MSG_NOSIGNAL
+        const int flags = MSG_NOSIGNAL;
+#else
+        const int flags = 0;
+#endif
+        while (c.fd >= 0 && c.sending) {
+            const std::vector<uchar>& data = *c.sending;
+            ssize_t n = ::send(c.fd, data.data() + c.offset, data.size() - c.offset, flags);
+            if (n > 0) {
+                c.offset += static_cast<size_t>(n);
+                if (c.offset == data.size()) {
+                    c.sending = std::move(c.next);
+                    c.next.reset();
+                    c.offset = 0;
+                    if (!c.sending && c.closeWhenSent) disconnect(c);
+                }
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return;
+            } else {
+                disconnect(c);
+            }
+        }
+    }
+
+    void disconnect(Client& c) {
+        if (c.fd >= 0) ::close(c.fd);
+        c.fd = -1;
+        c.streaming = false;
+        c.sending.reset();
+        c.next.reset();
+    }
+
+    static Packet text(const char* s) {
+        return std::make_shared<std::vector<uchar>>(s, s + std::strlen(s));
+    }
+
+    void wake() {
+        if (wakeFds_[1] < 0) return;
+        char byte = 1;
+        // A full pipe already means a wake-up is pending
+        ssize_t n = write(wakeFds_[1], &byte, 1);
+        (void)n;
+    }
+
+    void drainWake() {
+        char buffer[64];
+        while (read(wakeFds_[0], buffer, sizeof(buffer)) > 0) {
+        }
+    }
+
+    void closeAll() {
+        if (listenFd_ >= 0) ::close(listenFd_);
+        if (wakeFds_[0] >= 0) ::close(wakeFds_[0]);
+        if (wakeFds_[1] >= 0) ::close(wakeFds_[1]);
+        listenFd_ = -1;
+        wakeFds_[0] = wakeFds_[1] = -1;
+    }
+
+    static bool setNonBlocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) return false;
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        return true;
+    }
+#else
+    void wake() {}
+    void closeAll() {}
+#endif
+
+    bool fail(const std::string& message) {
+        error_ = message;
+        return false;
+    }
+
+    Settings settings_;
+    int listenFd_;
+    int wakeFds_[2];
+    std::thread worker_;
+    std::atomic<bool> running_;
+    std::string error_;
+
+    // Hand-over from the render loop
+    std::mutex mutex_;
+    bool hasJob_;
+    cv::Mat job_;
+
+    // Worker-only state
+    cv::Mat encoding_;
+    std::vector<uchar> jpeg_;
+    std::vector<Client> clients_;
+
+    // Statistics, written by the worker and read for display only
+    std::atomic<int> streaming_;
+    std::atomic<uint64_t> encoded_;
+    std::atomic<uint64_t> skipped_;
+    std::atomic<double> encodeMs_;
+};
+
+}  // namespace doodle
+
+#endif  // MJPEG_SERVER_H
@@ -0,0 +1,276 @@
+/**
+ * @file motion_tracker.h
+ * @brief Camera motion estimation on a worker thread
+ * @author Chethana G
+ * @date 2026-10-19
+ *
+ * MotionTracker follows sparse corner features from one frame to the next
+ * with pyramidal Lucas-Kanade optical flow on a downscaled copy of the frame
+ * and fits a homography to the matches with RANSAC. The main loop submits
+ * every frame right after capture and collects the result before
+ * compositing, waiting no longer than its time budget; frames the worker is
+ * too busy for are skipped and their motion is picked up by the next match.
+ */
+
+#ifndef MOTION_TRACKER_H
+#define MOTION_TRACKER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "memory_accounting.h"
+#include "overlay_text.h"
+
+namespace doodle {
+
+/**
+ * @class MotionTracker
+ * @brief Per-frame homography between consecutive tracked frames
+ */
+class MotionTracker {
+public:
+    /**
+     * @brief Tracking settings
+     */
+    struct Settings {
+        int maxFeatures = 200;   ///< Corners detected when tracks run low
+        int minFeatures = 80;    ///< Re-detect below this many surviving tracks
+        int trackWidth = 480;    ///< Frames are downscaled to this width first
+        int pyramidLevels = 3;   ///< Levels of the LK pyramid
+    };
+
+    MotionTracker() : running_(false), hasJob_(false), ready_(false), skipped_(0),
+                      features_(0), trackMs_(0) {}
+
+    ~MotionTracker() { stop(); }
+
+    MotionTracker(const MotionTracker&) = delete;
+    MotionTracker& operator=(const MotionTracker&) = delete;
+
+    /**
+     * @brief Start the worker thread with default settings
+     */
+    void start() { start(Settings()); }
+
+    /**
+     * @brief Start the worker thread
+     */
+    void start(const Settings& settings) {
+        stop();
+        settings_ = settings;
+        prevGray_.release();
+        prevPoints_.clear();
+        pending_ = cv::Matx33d::eye();
+        ready_ = false;
+        hasJob_ = false;
+        running_ = true;
+        worker_ = std::thread(&MotionTracker::run, this);
+    }
+
+    /**
+     * @brief Stop the worker thread, dropping any pending result
+     */
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_) return;
+            running_ = false;
+        }
+        wake_.notify_all();
+        if (worker_.joinable()) worker_.join();
+    }
+
+    bool isRunning() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return running_;
+    }
+
+    /**
+     * @brief Hand a frame to the worker
+     * @return False if the worker is still busy and the frame was skipped
+     */
+    bool submit(const cv::Mat& frame) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_ || hasJob_) {
+                skipped_++;
+                return false;
+            }
+            performance::ScopedMemoryTag tag(performance::MemoryTag::Preview);
+            frame.copyTo(job_);
+            hasJob_ = true;
+        }
+        wake_.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Take the motion measured since the last call
+     * @param motion Set to the homography from the frame of the previous
+     *               collect() to the most recently tracked frame
+     * @param waitMs How long to wait for the last submitted frame; negative
+     *               waits until it is done, which makes runs reproducible
+     * @return False if no new motion was measured
+     */
+    bool collect(cv::Matx33d& motion, double waitMs) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto done = [this] { return !hasJob_ || !running_; };
+        if (waitMs < 0) {
+            done_.wait(lock, done);
+        } else if (waitMs > 0) {
+            done_.wait_for(lock, std::chrono::duration<double, std::milli>(waitMs), done);
+        }
+        if (!ready_) return false;
+        motion = pending_;
+        pending_ = cv::Matx33d::eye();
+        ready_ = false;
+        return true;
+    }
+
+    /**
+     * @brief Forget tracked features, e.g. after a cut in the video
+     */
+    void resetTracks() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        resetTracks_ = true;
+    }
+
+    int features() const { return features_; }
+    double trackMs() const { return trackMs_; }
+    uint64_t skippedFrames() const { return skipped_; }
+
+    /**
+     * @brief Draw tracking statistics on image
+     * @param img Target image
+     * @param position Text position
+     */
+    void drawOverlay(cv::Mat& img, cv::Point position = cv::Point(10, 210)) const {
+        char text[96];
+        std::snprintf(text, sizeof(text), "Track: %d pts %.1fms skipped %llu", features(),
+                      trackMs(), static_cast<unsigned long long>(skippedFrames()));
+        performance::drawOverlayText(img, text, position, 0.5, cv::Scalar(255, 255, 0), 1);
+    }
+
+private:
+    void run() {
+        performance::ScopedMemoryTag tag(performance::MemoryTag::Preview);
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [this] { return hasJob_ || !running_; });
+            if (!running_) break;
+            if (resetTracks_) {
+                prevGray_.release();
+                resetTracks_ = false;
+            }
+            lock.unlock();
+
+            auto start = std::chrono::steady_clock::now();
+            cv::Matx33d motion;
+            bool tracked = track(job_, motion);
+            trackMs_ = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - start).count();
+
+            lock.lock();
+            if (tracked) {
+                pending_ = motion * pending_;
+                ready_ = true;
+            }
+            hasJob_ = false;
+            done_.notify_all();
+        }
+        hasJob_ = false;
+        done_.notify_all();
+    }
+
+    // Homography from the previous tracked frame to this one, in full-size pixels
+    bool track(const cv::Mat& frame, cv::Matx33d& motion) {
+        double scale = std::min(1.0, settings_.trackWidth / static_cast<double>(frame.cols));
+        cv::resize(frame, small_, cv::Size(), scale, scale, cv::INTER_AREA);
+        cv::cvtColor(small_, gray_, cv::COLOR_BGR2GRAY);
+
+        bool tracked = false;
+        if (!prevGray_.empty() && prevGray_.size() == gray_.size() && !prevPoints_.empty()) {
+            cv::calcOpticalFlowPyrLK(prevGray_, gray_, prevPoints_, points_, status_, error_,
+                                     cv::Size(21, 21), settings_.pyramidLevels);
+            from_.clear();
+            to_.clear();
+            for (size_t i = 0; i < status_.size(); i++) {
+                if (status_[i]) {
+                    from_.push_back(prevPoints_[i]);
+                    to_.push_back(points_[i]);
+                }
+            }
+            if (from_.size() >= 8) {
+                cv::Mat h = cv::findHomography(from_, to_, cv::RANSAC, 2.0, inliers_);
+                if (plausible(h)) {
+                    // Conjugate with the downscale: H_full = S^-1 * H * S
+                    cv::Matx33d s(scale, 0, 0, 0, scale, 0, 0, 0, 1);
+                    motion = s.inv() * cv::Matx33d(h) * s;
+                    tracked = true;
+                    keepInliers();
+                }
+            }
+        }
+
+        features_ = static_cast<int>(tracked ? prevPoints_.size() : 0);
+        if (features_ < settings_.minFeatures) {
+            cv::goodFeaturesToTrack(gray_, prevPoints_, settings_.maxFeatures, 0.01, 8);
+            features_ = static_cast<int>(prevPoints_.size());
+        }
+        cv::swap(prevGray_, gray_);
+        return tracked;
+    }
+
+    // Carry the RANSAC inliers forward as the tracks for the next frame
+    void keepInliers() {
+        prevPoints_.clear();
+        for (size_t i = 0; i < to_.size(); i++) {
+            if (inliers_.at<uchar>(static_cast<int>(i))) {
+                prevPoints_.push_back(to_[i]);
+            }
+        }
+    }
+
+    // Reject fits that flip, collapse or wildly distort the frame
+    static bool plausible(const cv::Mat& h) {
+        if (h.empty()) return false;
+        double det = h.at<double>(0, 0) * h.at<double>(1, 1) -
+                     h.at<double>(0, 1) * h.at<double>(1, 0);
+        return det > 0.5 && det < 2.0 && std::abs(h.at<double>(2, 0)) < 0.002 &&
+               std::abs(h.at<double>(2, 1)) < 0.002;
+    }
+
+    Settings settings_;
+    std::thread worker_;
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    bool running_;
+    bool hasJob_;
+    bool ready_;
+    bool resetTracks_ = false;
+    cv::Mat job_;
+    cv::Matx33d pending_;
+
+    // Worker-only state
+    cv::Mat small_, gray_, prevGray_, inliers_;
+    std::vector<cv::Point2f> prevPoints_, points_, from_, to_;
+    std::vector<uchar> status_;
+    std::vector<float> error_;
+
+    // Statistics, written by the worker and read for display only
+    std::atomic<uint64_t> skipped_;
+    std::atomic<int> features_;
+    std::atomic<double> trackMs_;
+};
+
+}  // namespace doodle
+
+#endif  // MOTION_TRACKER_H
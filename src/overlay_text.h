@@ -0,0 +1,48 @@
+/**
+ * @file overlay_text.h
+ * @brief Shared text output for the statistics overlays
+ * @author Chethana G
+ * @date 2026-10-19
+ *
+ * The overlays in the performance namespace draw their text through
+ * drawOverlayText(). By default that is cv::putText; the application can
+ * install a cheaper renderer (the glyph atlas) so that drawing the overlays
+ * neither re-rasterizes glyphs nor allocates.
+ */
+
+#ifndef OVERLAY_TEXT_H
+#define OVERLAY_TEXT_H
+
+#include <opencv2/opencv.hpp>
+
+namespace performance {
+
+/**
+ * @brief Function that draws one line of overlay text (Hershey simplex font)
+ */
+using OverlayTextRenderer = void (*)(cv::Mat& img, const char* text, cv::Point org,
+                                     double fontScale, const cv::Scalar& color, int thickness);
+
+/**
+ * @brief Renderer used by drawOverlayText(), null for cv::putText
+ */
+inline OverlayTextRenderer& overlayTextRenderer() {
+    static OverlayTextRenderer renderer = nullptr;
+    return renderer;
+}
+
+/**
+ * @brief Draw one line of overlay text
+ */
+inline void drawOverlayText(cv::Mat& img, const char* text, cv::Point org, double fontScale,
+                            const cv::Scalar& color, int thickness) {
+    if (OverlayTextRenderer renderer = overlayTextRenderer()) {
+        renderer(img, text, org, fontScale, color, thickness);
+    } else {
+        cv::putText(img, text, org, cv::FONT_HERSHEY_SIMPLEX, fontScale, color, thickness);
+    }
+}
+
+}  // namespace performance
+
+#endif  // OVERLAY_TEXT_H
@@ -9,9 +9,20 @@
 #define PERFORMANCE_MONITOR_H
 
 #include <chrono>
-#include <deque>
-#include <string>
+#include <cstdio>
+#include <vector>
 #include <opencv2/opencv.hpp>
+#include "overlay_text.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#elif __APPLE__
+#include <mach/mach.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace performance {
 
@@ -22,7 +33,8 @@ namespace performance {
 class FPSCounter {
 public:
     FPSCounter(int windowSize = 30)
-        : windowSize_(windowSize), fps_(0.0) {}
+        : windowSize_(std::max(windowSize, 1)), fps_(0.0), count_(0), next_(0), sum_(0.0),
+          frameTimes_(windowSize_, 0.0) {}
 
     /**
      * @brief Update FPS calculation with new frame time
@@ -33,19 +45,18 @@ public:
         if (lastFrame_.time_since_epoch().count() > 0) {
             auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
                 now - lastFrame_).count();
-            frameTimes_.push_back(duration);
             
-            if (frameTimes_.size() > windowSize_) {
-                frameTimes_.pop_front();
+            // Fixed ring of the last windowSize_ frame times with a running sum
+            if (count_ == windowSize_) {
+                sum_ -= frameTimes_[next_];
+            } else {
+                count_++;
             }
+            frameTimes_[next_] = static_cast<double>(duration);
+            sum_ += frameTimes_[next_];
+            next_ = (next_ + 1) % windowSize_;
             
-            // Calculate average FPS
-            double avgTime = 0.0;
-            for (const auto& time : frameTimes_) {
-                avgTime += time;
-            }
-            avgTime /= frameTimes_.size();
-            
+            double avgTime = sum_ / count_;
             fps_ = (avgTime > 0) ? 1000.0 / avgTime : 0.0;
         }
         
@@ -63,13 +74,7 @@ public:
      * @return Average frame time
      */
     double getAvgFrameTime() const {
-        if (frameTimes_.empty()) return 0.0;
-        
-        double sum = 0.0;
-        for (const auto& time : frameTimes_) {
-            sum += time;
-        }
-        return sum / frameTimes_.size();
+        return (count_ > 0) ? sum_ / count_ : 0.0;
     }
 
     /**
@@ -78,21 +83,25 @@ public:
      * @param position Text position
      */
     void drawOverlay(cv::Mat& img, cv::Point position = cv::Point(10, 30)) {
-        std::string fpsText = "FPS: " + std::to_string(static_cast<int>(fps_));
-        std::string frameTimeText = "Frame: " + 
-            std::to_string(static_cast<int>(getAvgFrameTime())) + "ms";
+        char fpsText[32];
+        char frameTimeText[32];
+        std::snprintf(fpsText, sizeof(fpsText), "FPS: %d", static_cast<int>(fps_));
+        std::snprintf(frameTimeText, sizeof(frameTimeText), "Frame: %dms",
+                      static_cast<int>(getAvgFrameTime()));
         
-        cv::putText(img, fpsText, position, cv::FONT_HERSHEY_SIMPLEX,
-                   0.7, cv::Scalar(0, 255, 0), 2);
-        cv::putText(img, frameTimeText, position + cv::Point(0, 30),
-                   cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 255, 0), 2);
+        drawOverlayText(img, fpsText, position, 0.7, cv::Scalar(0, 255, 0), 2);
+        drawOverlayText(img, frameTimeText, position + cv::Point(0, 30), 0.7,
+                        cv::Scalar(0, 255, 0), 2);
     }
 
 private:
-    int windowSize_;
+    size_t windowSize_;
     double fps_;
     std::chrono::time_point<std::chrono::high_resolution_clock> lastFrame_;
-    std::deque<double> frameTimes_;
+    size_t count_;
+    size_t next_;
+    double sum_;
+    std::vector<double> frameTimes_;
 };
 
 /**
@@ -119,17 +128,20 @@ public:
                                        (task_info_t)&info, &size);
         return (kerr == KERN_SUCCESS) ? info.resident_size / (1024.0 * 1024.0) : 0.0;
 #else
-        // Linux
+        // Linux: keep statm open and re-read it from the start on every call
+        static const int fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+        static const long pageSize = sysconf(_SC_PAGESIZE);
+        char buffer[128];
+        ssize_t n = (fd >= 0) ? pread(fd, buffer, sizeof(buffer) - 1, 0) : -1;
+        if (n <= 0) {
+            return 0.0;
+        }
+        buffer[n] = '\0';
         long rss = 0L;
-        FILE* fp = fopen("/proc/self/statm", "r");
-        if (fp) {
-            if (fscanf(fp, "%*s%ld", &rss) == 1) {
-                fclose(fp);
-                return (rss * sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0);
-            }
-            fclose(fp);
+        if (sscanf(buffer, "%*s%ld", &rss) != 1) {
+            return 0.0;
         }
-        return 0.0;
+        return (rss * pageSize) / (1024.0 * 1024.0);
 #endif
     }
 
@@ -140,11 +152,10 @@ public:
      */
     static void drawOverlay(cv::Mat& img, cv::Point position = cv::Point(10, 90)) {
         double memoryMB = getCurrentMemoryMB();
-        std::string memText = "Memory: " + 
-            std::to_string(static_cast<int>(memoryMB)) + " MB";
+        char memText[32];
+        std::snprintf(memText, sizeof(memText), "Memory: %d MB", static_cast<int>(memoryMB));
         
-        cv::putText(img, memText, position, cv::FONT_HERSHEY_SIMPLEX,
-                   0.7, cv::Scalar(255, 255, 0), 2);
+        drawOverlayText(img, memText, position, 0.7, cv::Scalar(255, 255, 0), 2);
     }
 };
 
@@ -0,0 +1,733 @@
+/**
+ * @file project_file.h
+ * @brief Tile-indexed project files that open lazily and save incrementally
+ * @author Chethana G
+ * @date 2026-10-19
+ *
+ * A project stores the canvas as independently compressed square tiles,
+ * followed by an index. Opening a project maps the file and reads only the
+ * header and the index; tiles are decoded when they are first needed. Saving
+ * back to the same file appends the tiles and history levels that changed and
+ * a new index, then rewrites the header to point at it, so unchanged tiles
+ * and levels are never touched.
+ *
+ * Layout (all integers little-endian):
+ *
+ * @code
+ *   0   char[8]  magic "LDOODLE\0"
+ *   8   u32      version
+ *   12  u32      width, height, type (cv::Mat type), tile size, layer count
+ *   32  u64      index offset, index size, garbage bytes, reserved
+ *   64  ...      tile and history payloads (PNG), in any order
+ *       index:   u32 tile count, then per tile u64 offset + u32 size
+ *                (layer-major, row-major; size 0 means an empty tile)
+ *                u32 undo count, u32 redo count, then per patch
+ *                i32 x, y, w, h + u64 offset + u32 size
+ *                u32 label count, then per label i32 x, y, u8 b, g, r,
+ *                thickness, f32 scale, u32 length + text
+ *                optionally u32 palette count, then per color u8 b, g, r
+ *                (palette-indexed canvases, type CV_8UC1)
+ * @endcode
+ *
+ * Replaced payloads stay in the file as garbage until it outgrows the live
+ * data, at which point the next save rewrites the file compactly.
+ */
+
+#ifndef PROJECT_FILE_H
+#define PROJECT_FILE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "history.h"
+#include "memory_accounting.h"
+#include "text_labels.h"
+
+#ifdef _WIN32
+#include <iterator>
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace doodle {
+
+/**
+ * @class ProjectFile
+ * @brief Reader and incremental writer for .ldp project files
+ */
+class ProjectFile {
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr int DEFAULT_TILE_SIZE = 128;
+
+    explicit ProjectFile(int tileSize = DEFAULT_TILE_SIZE)
+        : data_(nullptr), size_(0), tileSize_(tileSize), layers_(1), type_(-1),
+          garbage_(0) {}
+
+    ~ProjectFile() { unmap(); }
+
+    ProjectFile(const ProjectFile&) = delete;
+    ProjectFile& operator=(const ProjectFile&) = delete;
+
+    /**
+     * @brief Open a project, reading only its header and index
+     * @param path Project file
+     * @return False if the file is missing or malformed (see error())
+     */
+    bool open(const std::string& path) {
+        close();
+        if (!map(path) || !parse()) {
+            close();
+            return false;
+        }
+        path_ = path;
+        return true;
+    }
+
+    /**
+     * @brief Forget the open project
+     */
+    void close() {
+        unmap();
+        path_.clear();
+        tiles_.clear();
+        patches_.clear();
+        labels_.clear();
+        palette_.clear();
+        canvasSize_ = cv::Size();
+        type_ = -1;
+        layers_ = 1;
+        garbage_ = 0;
+    }
+
+    bool isOpen() const { return !path_.empty(); }
+    const std::string& path() const { return path_; }
+    const std::string& error() const { return error_; }
+    cv::Size canvasSize() const { return canvasSize_; }
+    int canvasType() const { return type_; }
+    int layerCount() const { return layers_; }
+    const std::vector<TextLabel>& labels() const { return labels_; }
+
+    /**
+     * @brief Palette colors of an indexed canvas (empty for BGR canvases)
+     */
+    const std::vector<cv::Vec3b>& palette() const { return palette_; }
+
+    /**
+     * @brief Decode the tiles of a region that have not been decoded yet
+     * @param canvas Canvas of canvasSize() and canvasType()
+     * @param region Region that is needed, e.g. the visible part
+     * @param decoded Receives the rectangles of non-empty decoded tiles
+     * @param layer Layer to decode
+     * @return Number of tiles that were decoded
+     */
+    int loadTiles(cv::Mat& canvas, const cv::Rect& region, std::vector<cv::Rect>& decoded,
+                  int layer = 0) {
+        decoded.clear();
+        if (!isOpen() || canvas.size() != canvasSize_ || canvas.type() != type_) return 0;
+
+        cv::Rect area = region & cv::Rect(cv::Point(), canvasSize_);
+        if (area.empty()) return 0;
+        int count = 0;
+        for (int ty = area.y / tileSize_; ty <= (area.br().y - 1) / tileSize_; ty++) {
+            for (int tx = area.x / tileSize_; tx <= (area.br().x - 1) / tileSize_; tx++) {
+                Tile& tile = tiles_[tileIndex(layer, tx, ty)];
+                if (tile.loaded) continue;
+                tile.loaded = true;
+                count++;
+
+                cv::Rect rect = tileRect(tx, ty);
+                cv::Mat target = canvas(rect);
+                if (tile.size == 0) {
+                    target.setTo(cv::Scalar::all(0));
+                    continue;
+                }
+                cv::Mat pixels = decode(tile.offset, tile.size);
+                if (pixels.size() != rect.size() || pixels.type() != type_) {
+                    target.setTo(cv::Scalar::all(0));
+                    continue;
+                }
+                pixels.copyTo(target);
+                decoded.push_back(rect);
+            }
+        }
+        return count;
+    }
+
+    /**
+     * @brief True once every tile of the open project has been decoded
+     */
+    bool fullyLoaded() const {
+        for (const auto& tile : tiles_) {
+            if (!tile.loaded) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Decode the saved undo and redo levels
+     * @return False if any patch could not be decoded
+     */
+    bool loadHistory(std::deque<History::Patch>& undo, std::deque<History::Patch>& redo) {
+        undo.clear();
+        redo.clear();
+        for (auto& entry : patches_) {
+            performance::ScopedMemoryTag tag(performance::MemoryTag::History);
+            cv::Mat pixels = decode(entry.offset, entry.size);
+            if (pixels.size() != entry.rect.size() || pixels.type() != type_) return false;
+            // Share the id, so saving the unchanged level again reuses these bytes;
+            // masks are not saved, so the level covers its whole rect
+            if (entry.id == 0) entry.id = History::nextId();
+            (entry.undo ? undo : redo)
+                .push_back(History::Patch{entry.rect, pixels, entry.id, cv::Mat()});
+        }
+        return true;
+    }
+
+    /**
+     * @brief Note that a region of the canvas changed since the last save
+     */
+    void markDirty(const cv::Rect& rect) {
+        cv::Rect area = rect & cv::Rect(cv::Point(), canvasSize_);
+        if (tiles_.empty() || area.empty()) return;
+        for (int ty = area.y / tileSize_; ty <= (area.br().y - 1) / tileSize_; ty++) {
+            for (int tx = area.x / tileSize_; tx <= (area.br().x - 1) / tileSize_; tx++) {
+                tiles_[tileIndex(0, tx, ty)].dirty = true;
+            }
+        }
+    }
+
+    /**
+     * @brief Save a canvas with its history and labels
+     *
+     * Saving to the open project appends only the tiles marked dirty and the
+     * history levels it does not hold yet; any other destination, a different
+     * canvas size or too much garbage writes a complete file through a
+     * temporary and a rename. Tiles that were never decoded, tiles of other
+     * layers and levels that were saved before are copied as compressed
+     * bytes. The saved file stays open.
+     * @param path Destination
+     * @param canvas Layer 0 of the canvas; all dirty tiles must be decoded
+     * @param history Undo history to save, or null
+     * @param labels Text labels to save
+     * @param palette Palette colors, for an indexed canvas
+     * @return False on I/O error (see error())
+     */
+    bool save(const std::string& path, const cv::Mat& canvas, const History* history,
+              const std::vector<TextLabel>& labels,
+              const std::vector<cv::Vec3b>& palette = {}) {
+        performance::ScopedMemoryTag tag(performance::MemoryTag::Export);
+        bool sameLayout = isOpen() && path == path_ && canvas.size() == canvasSize_ &&
+                          canvas.type() == type_;
+        bool ok = (sameLayout && garbage_ <= liveBytes())
+                      ? append(canvas, history, labels, palette)
+                      : rewrite(path, canvas, history, labels, palette);
+        if (!ok) return false;
+
+        // Keep the decoded state of every tile, only the file behind it changed
+        unmap();
+        if (!map(path)) {
+            close();
+            return false;
+        }
+        path_ = path;
+        labels_ = labels;
+        palette_ = palette;
+        for (auto& tile : tiles_) {
+            tile.dirty = false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Bytes of the file that are no longer referenced
+     */
+    uint64_t garbageBytes() const { return garbage_; }
+
+private:
+    static constexpr size_t HEADER_SIZE = 64;
+    // Limits for header fields, so a corrupt header cannot ask for huge indexes
+    static constexpr int MAX_DIMENSION = 1 << 15;
+    static constexpr int MAX_TILE_SIZE = 4096;
+    static constexpr int MAX_LAYERS = 64;
+    static constexpr char MAGIC[8] = {'L', 'D', 'O', 'O', 'D', 'L', 'E', '\0'};
+
+    struct Tile {
+        uint64_t offset = 0;
+        uint32_t size = 0;
+        bool loaded = false;
+        bool dirty = false;
+    };
+
+    struct PatchEntry {
+        cv::Rect rect;
+        uint64_t offset;
+        uint32_t size;
+        bool undo;
+        uint64_t id;  // History::Patch::id of the saved pixels, 0 until known
+    };
+
+    int tileCols() const { return (canvasSize_.width + tileSize_ - 1) / tileSize_; }
+    int tileRows() const { return (canvasSize_.height + tileSize_ - 1) / tileSize_; }
+
+    size_t tileIndex(int layer, int tx, int ty) const {
+        return (static_cast<size_t>(layer) * tileRows() + ty) * tileCols() + tx;
+    }
+
+    cv::Rect tileRect(int tx, int ty) const {
+        return cv::Rect(tx * tileSize_, ty * tileSize_, tileSize_, tileSize_) &
+               cv::Rect(cv::Point(), canvasSize_);
+    }
+
+    uint64_t liveBytes() const {
+        uint64_t bytes = 0;
+        for (const auto& tile : tiles_) bytes += tile.size;
+        for (const auto& entry : patches_) bytes += entry.size;
+        return bytes;
+    }
+
+    // --- Reading ---------------------------------------------------------
+
+    bool map(const std::string& path) {
+#ifdef _WIN32
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return fail("cannot open " + path);
+        buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        data_ = reinterpret_cast<const uint8_t*>(buffer_.data());
+        size_ = buffer_.size();
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return fail("cannot open " + path);
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(HEADER_SIZE)) {
+            ::close(fd);
+            return fail(path + " is not a project file");
+        }
+        void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED) return fail("cannot map " + path);
+        data_ = static_cast<const uint8_t*>(addr);
+        size_ = static_cast<size_t>(st.st_size);
+#endif
+        return true;
+    }
+
+    void unmap() {
+#ifdef _WIN32
+        buffer_.clear();
+#else
+        if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    bool parse() {
+        if (size_ < HEADER_SIZE || std::memcmp(data_, MAGIC, sizeof(MAGIC)) != 0) {
+            return fail("not a project file");
+        }
+        const uint8_t* p = data_ + 8;
+        if (get32(p) != VERSION) return fail("unsupported project version");
+        int width = static_cast<int>(get32(p));
+        int height = static_cast<int>(get32(p));
+        type_ = static_cast<int>(get32(p));
+        tileSize_ = static_cast<int>(get32(p));
+        layers_ = static_cast<int>(get32(p));
+        uint64_t indexOffset = get64(p);
+        uint64_t indexSize = get64(p);
+        garbage_ = get64(p);
+        if (width <= 0 || height <= 0 || width > MAX_DIMENSION || height > MAX_DIMENSION ||
+            tileSize_ <= 0 || tileSize_ > MAX_TILE_SIZE || layers_ <= 0 ||
+            layers_ > MAX_LAYERS || indexOffset < HEADER_SIZE || indexOffset > size_ ||
+            indexSize > size_ - indexOffset) {
+            return fail("corrupt project header");
+        }
+        canvasSize_ = cv::Size(width, height);
+
+        const uint8_t* q = data_ + indexOffset;
+        const uint8_t* end = q + indexSize;
+        uint64_t expected = static_cast<uint64_t>(tileCols()) * tileRows() * layers_;
+        if (end - q < 4 || get32(q) != expected ||
+            static_cast<uint64_t>(end - q) / 12 < expected) {  // 12 bytes per tile entry
+            return fail("corrupt tile index");
+        }
+        tiles_.assign(expected, Tile());
+        for (auto& tile : tiles_) {
+            if (end - q < 12) return fail("corrupt tile index");
+            tile.offset = get64(q);
+            tile.size = get32(q);
+            if (!validPayload(tile.offset, tile.size)) return fail("corrupt tile index");
+        }
+
+        if (end - q < 8) return fail("corrupt history index");
+        uint32_t undoCount = get32(q);
+        uint32_t redoCount = get32(q);
+        for (uint64_t i = 0; i < static_cast<uint64_t>(undoCount) + redoCount; i++) {
+            if (end - q < 28) return fail("corrupt history index");
+            PatchEntry entry;
+            entry.rect.x = static_cast<int32_t>(get32(q));
+            entry.rect.y = static_cast<int32_t>(get32(q));
+            entry.rect.width = static_cast<int32_t>(get32(q));
+            entry.rect.height = static_cast<int32_t>(get32(q));
+            entry.offset = get64(q);
+            entry.size = get32(q);
+            entry.undo = i < undoCount;
+            entry.id = 0;
+            if (!validPayload(entry.offset, entry.size)) return fail("corrupt history index");
+            patches_.push_back(entry);
+        }
+
+        if (end - q < 4) return fail("corrupt label index");
+        uint32_t labelCount = get32(q);
+        for (uint32_t i = 0; i < labelCount; i++) {
+            if (end - q < 20) return fail("corrupt label index");
+            TextLabel label;
+            label.origin.x = static_cast<int32_t>(get32(q));
+            label.origin.y = static_cast<int32_t>(get32(q));
+            label.color = cv::Scalar(q[0], q[1], q[2]);
+            label.thickness = q[3];
+            q += 4;
+            uint32_t bits = get32(q);
+            float scale;
+            std::memcpy(&scale, &bits, sizeof(scale));
+            label.scale = scale;
+            uint32_t length = get32(q);
+            if (static_cast<uint64_t>(end - q) < length) return fail("corrupt label index");
+            label.text.assign(reinterpret_cast<const char*>(q), length);
+            q += length;
+            labels_.push_back(label);
+        }
+
+        // Older files end here
+        if (end - q < 4) return true;
+        uint32_t colorCount = get32(q);
+        if (static_cast<uint64_t>(end - q) < colorCount * 3ull) return fail("corrupt palette");
+        for (uint32_t i = 0; i < colorCount; i++, q += 3) {
+            palette_.push_back(cv::Vec3b(q[0], q[1], q[2]));
+        }
+        return true;
+    }
+
+    bool validPayload(uint64_t offset, uint32_t size) const {
+        return size == 0 || (offset >= HEADER_SIZE && offset <= size_ && size <= size_ - offset);
+    }
+
+    cv::Mat decode(uint64_t offset, uint32_t size) const {
+        if (!data_ || size == 0) return cv::Mat();
+        // Header over the mapped bytes, no copy
+        cv::Mat bytes(1, static_cast<int>(size), CV_8UC1, const_cast<uint8_t*>(data_ + offset));
+        return cv::imdecode(bytes, cv::IMREAD_UNCHANGED);
+    }
+
+    // --- Writing ---------------------------------------------------------
+
+    // Append dirty tiles, history and a new index to the open file
+    bool append(const cv::Mat& canvas, const History* history,
+                const std::vector<TextLabel>& labels, const std::vector<cv::Vec3b>& palette) {
+        std::fstream file(path_, std::ios::in | std::ios::out | std::ios::binary);
+        if (!file) return fail("cannot write " + path_);
+        file.seekp(0, std::ios::end);
+        uint64_t offset = static_cast<uint64_t>(file.tellp());
+
+        // The old index and everything replaced below become garbage
+        uint64_t garbage = garbage_ + indexSizeOnDisk();
+        std::vector<uchar> encoded;
+        for (int ty = 0; ty < tileRows(); ty++) {
+            for (int tx = 0; tx < tileCols(); tx++) {
+                Tile& tile = tiles_[tileIndex(0, tx, ty)];
+                if (!tile.dirty || !tile.loaded) continue;
+                garbage += tile.size;
+                if (!encodeTile(canvas(tileRect(tx, ty)), encoded)) {
+                    tile.offset = 0;
+                    tile.size = 0;
+                    continue;
+                }
+                if (!writeBytes(file, encoded)) return fail("cannot write " + path_);
+                tile.offset = offset;
+                tile.size = static_cast<uint32_t>(encoded.size());
+                offset += encoded.size();
+            }
+        }
+        if (!writeHistory(file, offset, history, false, garbage)) {
+            return fail("cannot write " + path_);
+        }
+
+        std::vector<uint8_t> index = buildIndex(labels, palette);
+        uint64_t indexOffset = offset;
+        if (!writeBytes(file, index)) return fail("cannot write " + path_);
+        file.flush();
+
+        // Only now point the header at the new index
+        garbage_ = garbage;
+        std::vector<uint8_t> header = buildHeader(indexOffset, index.size(), garbage);
+        file.seekp(0);
+        if (!writeBytes(file, header) || !file.flush()) return fail("cannot write " + path_);
+        return true;
+    }
+
+    // Write a complete, compact file next to the destination and move it over
+    bool rewrite(const std::string& path, const cv::Mat& canvas, const History* history,
+                 const std::vector<TextLabel>& labels, const std::vector<cv::Vec3b>& palette) {
+        bool reuse = isOpen() && canvas.size() == canvasSize_ && canvas.type() == type_;
+        if (!reuse) {
+            canvasSize_ = canvas.size();
+            type_ = canvas.type();
+            layers_ = 1;
+            tiles_.assign(static_cast<size_t>(tileCols()) * tileRows(), Tile());
+        }
+
+        std::string temp = path + ".tmp";
+        std::fstream file(temp, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!file) return fail("cannot write " + temp);
+        std::vector<uint8_t> header(HEADER_SIZE, 0);
+        if (!writeBytes(file, header)) return fail("cannot write " + temp);
+
+        uint64_t offset = HEADER_SIZE;
+        std::vector<uchar> encoded;
+        std::vector<Tile> written(tiles_.size());
+        for (int layer = 0; layer < layers_; layer++) {
+            for (int ty = 0; ty < tileRows(); ty++) {
+                for (int tx = 0; tx < tileCols(); tx++) {
+                    size_t i = tileIndex(layer, tx, ty);
+                    const Tile& tile = tiles_[i];
+                    written[i].loaded = !reuse || tile.loaded;
+                    if (reuse && (layer > 0 || !tile.dirty || !tile.loaded)) {
+                        // Unchanged, never decoded or not on the saved layer:
+                        // copy the compressed bytes as they are
+                        if (tile.size == 0) continue;
+                        encoded.assign(data_ + tile.offset, data_ + tile.offset + tile.size);
+                    } else if (!encodeTile(canvas(tileRect(tx, ty)), encoded)) {
+                        continue;
+                    }
+                    if (!writeBytes(file, encoded)) return fail("cannot write " + temp);
+                    written[i].offset = offset;
+                    written[i].size = static_cast<uint32_t>(encoded.size());
+                    offset += encoded.size();
+                }
+            }
+        }
+        tiles_.swap(written);
+        uint64_t dropped = 0;
+        if (!writeHistory(file, offset, history, true, dropped)) {
+            return fail("cannot write " + temp);
+        }
+
+        std::vector<uint8_t> index = buildIndex(labels, palette);
+        if (!writeBytes(file, index)) return fail("cannot write " + temp);
+        garbage_ = 0;
+        header = buildHeader(offset, index.size(), 0);
+        file.seekp(0);
+        if (!writeBytes(file, header) || !file.flush()) return fail("cannot write " + temp);
+        file.close();
+
+        unmap();
+#ifdef _WIN32
+        // rename() cannot replace an existing file on Windows; this can, in one step
+        if (!MoveFileExA(temp.c_str(), path.c_str(),
+                         MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+            return fail("cannot replace " + path);
+        }
+#else
+        if (std::rename(temp.c_str(), path.c_str()) != 0) {
+            return fail("cannot replace " + path);
+        }
+#endif
+        return true;
+    }
+
+    // Write the history levels that are not in the open file yet. Levels that
+    // are (same patch id) keep their bytes where they are, or are copied
+    // compressed when copy is set; the bytes of saved levels that are gone
+    // are added to garbage.
+    bool writeHistory(std::fstream& file, uint64_t& offset, const History* history, bool copy,
+                      uint64_t& garbage) {
+        std::vector<PatchEntry> saved;
+        saved.swap(patches_);
+        std::vector<bool> kept(saved.size(), false);
+        std::vector<uchar> encoded;
+        for (int pass = 0; history && pass < 2; pass++) {
+            const auto& levels = pass == 0 ? history->undoPatches() : history->redoPatches();
+            for (const auto& patch : levels) {
+                size_t i = 0;
+                while (i < saved.size() && (patch.id == 0 || saved[i].id != patch.id)) i++;
+                if (i < saved.size() && saved[i].rect == patch.rect) {
+                    kept[i] = true;
+                    PatchEntry entry = saved[i];
+                    entry.undo = pass == 0;
+                    if (copy) {
+                        encoded.assign(data_ + entry.offset, data_ + entry.offset + entry.size);
+                        if (!writeBytes(file, encoded)) return false;
+                        entry.offset = offset;
+                        offset += entry.size;
+                    }
+                    patches_.push_back(entry);
+                    continue;
+                }
+                if (!cv::imencode(".png", patch.pixels, encoded, pngParams())) continue;
+                if (!writeBytes(file, encoded)) return false;
+                patches_.push_back(PatchEntry{patch.rect, offset,
+                                              static_cast<uint32_t>(encoded.size()), pass == 0,
+                                              patch.id});
+                offset += encoded.size();
+            }
+        }
+        for (size_t i = 0; i < saved.size(); i++) {
+            if (!kept[i]) garbage += saved[i].size;
+        }
+        return true;
+    }
+
+    // Compress a tile, or return false if it is entirely empty
+    static bool encodeTile(const cv::Mat& tile, std::vector<uchar>& encoded) {
+        bool empty = true;
+        for (int y = 0; y < tile.rows && empty; y++) {
+            const uchar* row = tile.ptr<uchar>(y);
+            size_t bytes = tile.cols * tile.elemSize();
+            empty = std::all_of(row, row + bytes, [](uchar v) { return v == 0; });
+        }
+        return !empty && cv::imencode(".png", tile, encoded, pngParams());
+    }
+
+    static const std::vector<int>& pngParams() {
+        // Fast compression: tiles are small and saves should not stall a frame
+        static const std::vector<int> params = {cv::IMWRITE_PNG_COMPRESSION, 1};
+        return params;
+    }
+
+    std::vector<uint8_t> buildHeader(uint64_t indexOffset, uint64_t indexSize,
+                                     uint64_t garbage) const {
+        std::vector<uint8_t> out(MAGIC, MAGIC + sizeof(MAGIC));
+        put32(out, VERSION);
+        put32(out, static_cast<uint32_t>(canvasSize_.width));
+        put32(out, static_cast<uint32_t>(canvasSize_.height));
+        put32(out, static_cast<uint32_t>(type_));
+        put32(out, static_cast<uint32_t>(tileSize_));
+        put32(out, static_cast<uint32_t>(layers_));
+        put64(out, indexOffset);
+        put64(out, indexSize);
+        put64(out, garbage);
+        out.resize(HEADER_SIZE, 0);
+        return out;
+    }
+
+    std::vector<uint8_t> buildIndex(const std::vector<TextLabel>& labels,
+                                    const std::vector<cv::Vec3b>& palette) const {
+        std::vector<uint8_t> out;
+        put32(out, static_cast<uint32_t>(tiles_.size()));
+        for (const auto& tile : tiles_) {
+            put64(out, tile.offset);
+            put32(out, tile.size);
+        }
+
+        uint32_t undoCount = 0;
+        for (const auto& entry : patches_) undoCount += entry.undo ? 1 : 0;
+        put32(out, undoCount);
+        put32(out, static_cast<uint32_t>(patches_.size()) - undoCount);
+        for (const auto& entry : patches_) {
+            put32(out, static_cast<uint32_t>(entry.rect.x));
+            put32(out, static_cast<uint32_t>(entry.rect.y));
+            put32(out, static_cast<uint32_t>(entry.rect.width));
+            put32(out, static_cast<uint32_t>(entry.rect.height));
+            put64(out, entry.offset);
+            put32(out, entry.size);
+        }
+
+        put32(out, static_cast<uint32_t>(labels.size()));
+        for (const auto& label : labels) {
+            put32(out, static_cast<uint32_t>(label.origin.x));
+            put32(out, static_cast<uint32_t>(label.origin.y));
+            for (int c = 0; c < 3; c++) {
+                out.push_back(cv::saturate_cast<uchar>(label.color[c]));
+            }
+            out.push_back(cv::saturate_cast<uchar>(label.thickness));
+            float scale = static_cast<float>(label.scale);
+            uint32_t bits;
+            std::memcpy(&bits, &scale, sizeof(bits));
+            put32(out, bits);
+            put32(out, static_cast<uint32_t>(label.text.size()));
+            out.insert(out.end(), label.text.begin(), label.text.end());
+        }
+
+        if (!palette.empty()) {
+            put32(out, static_cast<uint32_t>(palette.size()));
+            for (const auto& color : palette) {
+                out.insert(out.end(), color.val, color.val + 3);
+            }
+        }
+        return out;
+    }
+
+    uint64_t indexSizeOnDisk() const {
+        if (!data_) return 0;
+        const uint8_t* p = data_ + 40;
+        return get64(p);
+    }
+
+    template <typename Bytes>
+    static bool writeBytes(std::fstream& file, const Bytes& bytes) {
+        file.write(reinterpret_cast<const char*>(bytes.data()),
+                   static_cast<std::streamsize>(bytes.size()));
+        return static_cast<bool>(file);
+    }
+
+    static void put32(std::vector<uint8_t>& out, uint32_t v) {
+        for (int i = 0; i < 4; i++) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    static void put64(std::vector<uint8_t>& out, uint64_t v) {
+        for (int i = 0; i < 8; i++) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    static uint32_t get32(const uint8_t*& p) {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; i++) v |= static_cast<uint32_t>(p[i]) << (8 * i);
+        p += 4;
+        return v;
+    }
+
+    static uint64_t get64(const uint8_t*& p) {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; i++) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+        p += 8;
+        return v;
+    }
+
+    bool fail(const std::string& message) {
+        error_ = message;
+        return false;
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+#ifdef _WIN32
+    std::vector<char> buffer_;
+#endif
+    std::string path_;
+    std::string error_;
+    cv::Size canvasSize_;
+    int tileSize_;
+    int layers_;
+    int type_;
+    uint64_t garbage_;
+    std::vector<Tile> tiles_;
+    std::vector<PatchEntry> patches_;
+    std::vector<TextLabel> labels_;
+    std::vector<cv::Vec3b> palette_;
+};
+
+}  // namespace doodle
+
+#endif  // PROJECT_FILE_H
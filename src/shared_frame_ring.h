@@ -0,0 +1,412 @@
+/**
+ * @file shared_frame_ring.h
+ * @brief Composited frames published to other processes through shared memory
+ * @author Chethana G
+ * @date 2026-10-19
+ *
+ * The application creates a POSIX shared-memory object holding a ring of
+ * frame slots and copies every composited frame into the next slot. Local
+ * consumers (virtual-camera bridges, recorders, streaming tools) map the same
+ * object and read frames in place, without an encode or a socket in between.
+ *
+ * Layout:
+ *
+ * @code
+ *   0     RingHeader  (128 bytes)
+ *   128   slot 0: SlotHeader (64 bytes) + pixels (rows packed, padded to 64)
+ *         slot 1 ...
+ * @endcode
+ *
+ * Every frame gets a sequence number, starting at 1. A slot's state word is
+ * sequence * 2 while the frame is complete and sequence * 2 + 1 while it is
+ * being written, so a reader can check that the slot did not change under it
+ * (a seqlock). After each frame the publisher bumps a futex word in the
+ * header and wakes all waiters; on systems without futexes readers poll.
+ *
+ * Timestamps are std::chrono::steady_clock nanoseconds, which on Linux is
+ * CLOCK_MONOTONIC and therefore comparable between processes.
+ */
+
+#ifndef SHARED_FRAME_RING_H
+#define SHARED_FRAME_RING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <opencv2/opencv.hpp>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <ctime>
+#endif
+
+namespace doodle {
+
+/**
+ * @class SharedFrameRing
+ * @brief Publisher and reader side of the shared-memory frame ring
+ */
+class SharedFrameRing {
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t DEFAULT_SLOTS = 4;
+
+    /**
+     * @brief A frame read from the ring
+     *
+     * image points straight into shared memory; it stays intact only while
+     * valid() returns true for it.
+     */
+    struct Frame {
+        cv::Mat image;
+        uint64_t sequence = 0;
+        uint64_t frameIndex = 0;   ///< Publisher's frame counter
+        int64_t timestampNs = 0;   ///< steady_clock time of publication
+    };
+
+    SharedFrameRing() : base_(nullptr), bytes_(0), owner_(false) {}
+
+    ~SharedFrameRing() { close(); }
+
+    SharedFrameRing(const SharedFrameRing&) = delete;
+    SharedFrameRing& operator=(const SharedFrameRing&) = delete;
+
+    /**
+     * @brief Create the ring as the publisher
+     * @param name Shared-memory object name, e.g. "/livedoodle"
+     * @param size Frame size
+     * @param type Frame type (continuous cv::Mat type)
+     * @param slots Number of frames kept; readers have slots - 1 frame
+     *              times to finish with a frame before it is overwritten
+     * @return False on failure (see error())
+     */
+    bool create(const std::string& name, cv::Size size, int type,
+                uint32_t slots = DEFAULT_SLOTS) {
+        close();
+#ifdef _WIN32
+        (void)name; (void)size; (void)type; (void)slots;
+        return fail("shared-memory output is not supported on Windows");
+#else
+        if (size.width <= 0 || size.height <= 0 || slots < 2) {
+            return fail("invalid ring geometry");
+        }
+        uint64_t frameBytes = static_cast<uint64_t>(size.area()) * CV_ELEM_SIZE(type);
+        uint64_t slotBytes = SLOT_HEADER_SIZE + align(frameBytes);
+        size_t total = static_cast<size_t>(HEADER_SIZE + slotBytes * slots);
+
+        // A leftover object from a crashed run is replaced, not reused
+        shm_unlink(name.c_str());
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) return fail("cannot create shared memory " + name);
+        if (ftruncate(fd, static_cast<off_t>(total)) != 0) {
+            ::close(fd);
+            shm_unlink(name.c_str());
+            return fail("cannot size shared memory " + name);
+        }
+        if (!map(fd, total)) {
+            shm_unlink(name.c_str());
+            return fail("cannot map shared memory " + name);
+        }
+        name_ = name;
+        owner_ = true;
+
+        // ftruncate zero-fills, so every slot starts out empty (state 0)
+        RingHeader* h = header();
+        h->version = VERSION;
+        h->slots = slots;
+        h->width = static_cast<uint32_t>(size.width);
+        h->height = static_cast<uint32_t>(size.height);
+        h->type = static_cast<uint32_t>(type);
+        h->slotBytes = slotBytes;
+        h->frameBytes = frameBytes;
+        h->latest.store(0, std::memory_order_relaxed);
+        h->futex.store(0, std::memory_order_relaxed);
+        // The magic goes last: readers ignore the ring until it is complete
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(h->magic, MAGIC, sizeof(h->magic));
+        sequence_ = 0;
+        return true;
+#endif
+    }
+
+    /**
+     * @brief Attach to an existing ring as a reader
+     * @param name Shared-memory object name used by the publisher
+     * @return False on failure (see error())
+     */
+    bool open(const std::string& name) {
+        close();
+#ifdef _WIN32
+        (void)name;
+        return fail("shared-memory output is not supported on Windows");
+#else
+        int fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) return fail("no shared memory named " + name);
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(HEADER_SIZE)) {
+            ::close(fd);
+            return fail(name + " is not a frame ring");
+        }
+        if (!map(fd, static_cast<size_t>(st.st_size))) {
+            return fail("cannot map shared memory " + name);
+        }
+        const RingHeader* h = header();
+        if (std::memcmp(h->magic, MAGIC, sizeof(h->magic)) != 0 || h->version != VERSION ||
+            HEADER_SIZE + h->slotBytes * h->slots > bytes_) {
+            close();
+            return fail(name + " is not a frame ring (or not initialized yet)");
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        name_ = name;
+        return true;
+#endif
+    }
+
+    /**
+     * @brief Detach; the publisher also removes the shared-memory object
+     */
+    void close() {
+#ifndef _WIN32
+        if (base_) munmap(base_, bytes_);
+        if (owner_) shm_unlink(name_.c_str());
+#endif
+        base_ = nullptr;
+        bytes_ = 0;
+        owner_ = false;
+        name_.clear();
+    }
+
+    bool isOpen() const { return base_ != nullptr; }
+
+    /**
+     * @brief Copy a frame into the next slot and wake the readers
+     * @param frame Frame of the ring's size and type
+     * @param frameIndex Publisher's frame counter, passed through to readers
+     * @return False if the frame does not fit the ring
+     */
+    bool publish(const cv::Mat& frame, uint64_t frameIndex) {
+        if (!base_ || !owner_ || frame.size() != size() || frame.type() != type()) {
+            return false;
+        }
+        RingHeader* h = header();
+        uint64_t sequence = ++sequence_;
+        SlotHeader* slot = slotHeader(sequence);
+
+        slot->state.store(sequence * 2 + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        uint8_t* pixels = slotPixels(slot);
+        size_t rowBytes = frame.cols * frame.elemSize();
+        if (frame.isContinuous()) {
+            std::memcpy(pixels, frame.data, rowBytes * frame.rows);
+        } else {
+            for (int y = 0; y < frame.rows; y++) {
+                std::memcpy(pixels + y * rowBytes, frame.ptr(y), rowBytes);
+            }
+        }
+        slot->frameIndex = frameIndex;
+        slot->timestampNs = now();
+        slot->state.store(sequence * 2, std::memory_order_release);
+
+        h->latest.store(sequence, std::memory_order_release);
+        h->futex.fetch_add(1, std::memory_order_release);
+        wake(&h->futex);
+        return true;
+    }
+
+    /**
+     * @brief Sequence number of the newest complete frame, 0 if none yet
+     */
+    uint64_t latestSequence() const {
+        return base_ ? header()->latest.load(std::memory_order_acquire) : 0;
+    }
+
+    /**
+     * @brief Wait until a frame newer than a sequence number is published
+     * @param after Last sequence number the caller has seen
+     * @param timeoutMs Longest wait; negative waits forever
+     * @return False on timeout
+     */
+    bool wait(uint64_t after, double timeoutMs) const {
+        if (!base_) return false;
+        const RingHeader* h = header();
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                            std::chrono::duration<double, std::milli>(timeoutMs));
+        while (true) {
+            uint32_t word = h->futex.load(std::memory_order_acquire);
+            if (h->latest.load(std::memory_order_acquire) > after) return true;
+            double remainingMs = -1.0;
+            if (timeoutMs >= 0) {
+                remainingMs = std::chrono::duration<double, std::milli>(
+                                  deadline - std::chrono::steady_clock::now()).count();
+                if (remainingMs <= 0) return false;
+            }
+            waitOn(&h->futex, word, remainingMs);
+        }
+    }
+
+    /**
+     * @brief Look at a published frame without copying it
+     * @param sequence Sequence number, usually latestSequence()
+     * @param frame Set to a view of the slot
+     * @return False if that frame has already been overwritten
+     */
+    bool read(uint64_t sequence, Frame& frame) const {
+        if (!base_ || sequence == 0) return false;
+        const SlotHeader* slot = slotHeader(sequence);
+        if (slot->state.load(std::memory_order_acquire) != sequence * 2) return false;
+
+        const RingHeader* h = header();
+        frame.image = cv::Mat(static_cast<int>(h->height), static_cast<int>(h->width),
+                              static_cast<int>(h->type),
+                              const_cast<uint8_t*>(slotPixels(slot)));
+        frame.sequence = sequence;
+        frame.frameIndex = slot->frameIndex;
+        frame.timestampNs = slot->timestampNs;
+        return valid(frame);
+    }
+
+    /**
+     * @brief Check that a frame's slot has not been reused since it was read
+     *
+     * Call after processing a frame to know whether the pixels were torn.
+     */
+    bool valid(const Frame& frame) const {
+        if (!base_ || frame.sequence == 0) return false;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slotHeader(frame.sequence)->state.load(std::memory_order_relaxed) ==
+               frame.sequence * 2;
+    }
+
+    cv::Size size() const {
+        return base_ ? cv::Size(static_cast<int>(header()->width),
+                                static_cast<int>(header()->height))
+                     : cv::Size();
+    }
+
+    int type() const { return base_ ? static_cast<int>(header()->type) : -1; }
+    uint32_t slots() const { return base_ ? header()->slots : 0; }
+    const std::string& name() const { return name_; }
+    const std::string& error() const { return error_; }
+
+    /**
+     * @brief steady_clock time in nanoseconds, the clock of Frame::timestampNs
+     */
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    static constexpr char MAGIC[8] = {'L', 'D', 'F', 'R', 'A', 'M', 'E', 'S'};
+    static constexpr uint64_t HEADER_SIZE = 128;
+    static constexpr uint64_t SLOT_HEADER_SIZE = 64;
+
+    struct RingHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t slots;
+        uint32_t width;
+        uint32_t height;
+        uint32_t type;
+        uint32_t reserved;
+        uint64_t slotBytes;    ///< Slot header plus padded pixels
+        uint64_t frameBytes;   ///< Packed pixels of one frame
+        alignas(64) std::atomic<uint64_t> latest;
+        std::atomic<uint32_t> futex;
+    };
+
+    struct SlotHeader {
+        std::atomic<uint64_t> state;
+        uint64_t frameIndex;
+        int64_t timestampNs;
+    };
+
+    static_assert(sizeof(RingHeader) <= HEADER_SIZE, "ring header too large");
+    static_assert(sizeof(SlotHeader) <= SLOT_HEADER_SIZE, "slot header too large");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+                  "shared-memory atomics must be lock-free");
+
+    static uint64_t align(uint64_t bytes) { return (bytes + 63) / 64 * 64; }
+
+#ifndef _WIN32
+    bool map(int fd, size_t bytes) {
+        void* addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED) return false;
+        base_ = static_cast<uint8_t*>(addr);
+        bytes_ = bytes;
+        return true;
+    }
+#endif
+
+    RingHeader* header() const { return reinterpret_cast<RingHeader*>(base_); }
+
+    SlotHeader* slotHeader(uint64_t sequence) const {
+        const RingHeader* h = header();
+        uint64_t index = sequence % h->slots;
+        return reinterpret_cast<SlotHeader*>(base_ + HEADER_SIZE + index * h->slotBytes);
+    }
+
+    static uint8_t* slotPixels(const SlotHeader* slot) {
+        return reinterpret_cast<uint8_t*>(const_cast<SlotHeader*>(slot)) + SLOT_HEADER_SIZE;
+    }
+
+    static void wake(std::atomic<uint32_t>* word) {
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT32_MAX, nullptr,
+                nullptr, 0);
+#else
+        (void)word;
+#endif
+    }
+
+    static void waitOn(const std::atomic<uint32_t>* word, uint32_t expected, double timeoutMs) {
+#ifdef __linux__
+        struct timespec timeout;
+        struct timespec* limit = nullptr;
+        if (timeoutMs >= 0) {
+            int64_t ns = static_cast<int64_t>(timeoutMs * 1e6);
+            timeout.tv_sec = static_cast<time_t>(ns / 1000000000);
+            timeout.tv_nsec = static_cast<long>(ns % 1000000000);
+            limit = &timeout;
+        }
+        syscall(SYS_futex, reinterpret_cast<const uint32_t*>(word), FUTEX_WAIT, expected, limit,
+                nullptr, 0);
+#else
+        // No futex: poll at 1 ms, well below a frame time
+        (void)word;
+        (void)expected;
+        (void)timeoutMs;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+    }
+
+    bool fail(const std::string& message) {
+        error_ = message;
+        return false;
+    }
+
+    uint8_t* base_;
+    size_t bytes_;
+    bool owner_;
+    uint64_t sequence_ = 0;
+    std::string name_;
+    std::string error_;
+};
+
+}  // namespace doodle
+
+#endif  // SHARED_FRAME_RING_H
@@ -0,0 +1,51 @@
+/**
+ * @file stroke_op.h
+ * @brief Stroke operations shared by the doodle engine and the sync protocol
+ * @author Chethana G
+ * @date 2026-10-19
+ */
+
+#ifndef STROKE_OP_H
+#define STROKE_OP_H
+
+#include <cstdint>
+#include <vector>
+
+namespace collab {
+
+/**
+ * @brief Kind of stroke operation
+ */
+enum class StrokeOpType : uint8_t {
+    Begin = 1,  ///< Mouse down: carries tool, size, color and RNG seed
+    Move = 2,   ///< Mouse move while drawing
+    End = 3,    ///< Mouse up: commits shape tools
+    Clear = 4,  ///< Clear the whole canvas
+    Cancel = 5  ///< Abandon the stroke in progress
+};
+
+/**
+ * @brief One stroke operation as produced by the mouse callback
+ */
+struct StrokeOp {
+    StrokeOpType type = StrokeOpType::Move;
+    uint8_t tool = 0;              ///< ToolRegistry id (Begin only)
+    uint8_t size = 0;              ///< Brush size in pixels (Begin only)
+    uint8_t color[3] = {0, 0, 0};  ///< BGR color (Begin only)
+    uint32_t seed = 0;             ///< Seed for stochastic tools (Begin only)
+    int32_t x = 0;                 ///< Canvas X coordinate
+    int32_t y = 0;                 ///< Canvas Y coordinate
+};
+
+/**
+ * @brief All operations one instance produced during one frame
+ */
+struct StrokeBatch {
+    uint32_t instanceId = 0;
+    uint64_t clock = 0;  ///< Sender's Lamport clock when the batch was sent
+    std::vector<StrokeOp> ops;
+};
+
+}  // namespace collab
+
+#endif  // STROKE_OP_H
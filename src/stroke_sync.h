@@ -0,0 +1,618 @@
+/**
+ * @file stroke_sync.h
+ * @brief Stroke-operation sync between drawing instances over local sockets
+ * @author Chethana G
+ * @date 2026-10-19
+ *
+ * Instead of streaming canvas pixels, each instance broadcasts the stroke
+ * operations produced by its mouse callback. Operations are collected into
+ * one batch per rendered frame and delta-encoded (zigzag varints relative to
+ * the previous point in the batch), so a typical brush segment costs three
+ * bytes on the wire. Peers talk over Unix domain sockets or TCP; a listening
+ * instance relays every batch it receives to its other peers.
+ *
+ * Every batch carries the sender's Lamport clock, which moves past every clock
+ * the instance has received. Batches are applied in (clock, instance id)
+ * order, the instance's own batches included, so peers that see the same
+ * batches draw overlapping strokes in the same order.
+ *
+ * Sockets are POSIX only. On Windows the codec works, but the peer cannot
+ * listen, connect or attach and reports why through error().
+ */
+
+#ifndef STROKE_SYNC_H
+#define STROKE_SYNC_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "stroke_op.h"
+
+namespace collab {
+
+/**
+ * @class StrokeCodec
+ * @brief Compact wire encoding for stroke batches
+ *
+ * Packet layout: u32 little-endian payload length, then the payload:
+ * magic, version, varint instance id, varint Lamport clock, varint op count
+ * and the ops. Coordinates are zigzag varint deltas from the previous op in
+ * the same batch (the first op is relative to the origin).
+ */
+class StrokeCodec {
+public:
+    static constexpr uint8_t MAGIC = 0xD5;
+    static constexpr uint8_t VERSION = 2;
+    static constexpr size_t HEADER_SIZE = 4;
+    static constexpr uint32_t MAX_PAYLOAD = 1u << 20;
+
+    /**
+     * @brief Append an encoded packet for a batch to a buffer
+     * @param batch Batch to encode
+     * @param out Destination buffer (appended to)
+     */
+    static void encode(const StrokeBatch& batch, std::vector<uint8_t>& out) {
+        size_t start = out.size();
+        out.resize(start + HEADER_SIZE);
+        out.push_back(MAGIC);
+        out.push_back(VERSION);
+        putVarint(out, batch.instanceId);
+        putVarint(out, batch.clock);
+        putVarint(out, batch.ops.size());
+
+        int32_t cursorX = 0;
+        int32_t cursorY = 0;
+        for (const auto& op : batch.ops) {
+            out.push_back(static_cast<uint8_t>(op.type));
+            if (!hasPosition(op.type)) {
+                continue;
+            }
+            if (op.type == StrokeOpType::Begin) {
+                out.push_back(op.tool);
+                out.push_back(op.size);
+                out.insert(out.end(), op.color, op.color + 3);
+                putVarint(out, op.seed);
+            }
+            putVarint(out, zigzag(static_cast<int64_t>(op.x) - cursorX));
+            putVarint(out, zigzag(static_cast<int64_t>(op.y) - cursorY));
+            cursorX = op.x;
+            cursorY = op.y;
+        }
+
+        uint32_t length = static_cast<uint32_t>(out.size() - start - HEADER_SIZE);
+        for (size_t i = 0; i < HEADER_SIZE; i++) {
+            out[start + i] = static_cast<uint8_t>(length >> (8 * i));
+        }
+    }
+
+    /**
+     * @brief Length of the packet at the front of a buffer
+     * @param data Buffer start
+     * @param size Bytes available
+     * @return Total packet size, 0 if incomplete, SIZE_MAX if malformed
+     */
+    static size_t packetSize(const uint8_t* data, size_t size) {
+        if (size < HEADER_SIZE) return 0;
+        uint32_t length = 0;
+        for (size_t i = 0; i < HEADER_SIZE; i++) {
+            length |= static_cast<uint32_t>(data[i]) << (8 * i);
+        }
+        if (length > MAX_PAYLOAD) return SIZE_MAX;
+        return (size >= HEADER_SIZE + length) ? HEADER_SIZE + length : 0;
+    }
+
+    /**
+     * @brief Decode one complete packet
+     * @param data Packet start (including length header)
+     * @param size Packet size as returned by packetSize()
+     * @param batch Decoded batch
+     * @return False if the packet is malformed
+     */
+    static bool decode(const uint8_t* data, size_t size, StrokeBatch& batch) {
+        const uint8_t* p = data + HEADER_SIZE;
+        const uint8_t* end = data + size;
+        if (end - p < 2 || p[0] != MAGIC || p[1] != VERSION) return false;
+        p += 2;
+
+        uint64_t instanceId, clock, count;
+        if (!getVarint(p, end, instanceId) || !getVarint(p, end, clock) ||
+            !getVarint(p, end, count) || count > static_cast<uint64_t>(end - p)) {
+            return false;
+        }
+        batch.instanceId = static_cast<uint32_t>(instanceId);
+        batch.clock = clock;
+        batch.ops.clear();
+        batch.ops.reserve(count);
+
+        int32_t cursorX = 0;
+        int32_t cursorY = 0;
+        for (uint64_t i = 0; i < count; i++) {
+            if (p >= end) return false;
+            StrokeOp op;
+            op.type = static_cast<StrokeOpType>(*p++);
+            if (op.type == StrokeOpType::Begin) {
+                if (end - p < 5) return false;
+                op.tool = *p++;
+                op.size = *p++;
+                std::copy(p, p + 3, op.color);
+                p += 3;
+                uint64_t seed;
+                if (!getVarint(p, end, seed)) return false;
+                op.seed = static_cast<uint32_t>(seed);
+            } else if (op.type != StrokeOpType::Move && op.type != StrokeOpType::End &&
+                       op.type != StrokeOpType::Clear && op.type != StrokeOpType::Cancel) {
+                return false;
+            }
+            if (hasPosition(op.type)) {
+                uint64_t dx, dy;
+                if (!getVarint(p, end, dx) || !getVarint(p, end, dy)) return false;
+                cursorX += unzigzag(dx);
+                cursorY += unzigzag(dy);
+                op.x = cursorX;
+                op.y = cursorY;
+            }
+            batch.ops.push_back(op);
+        }
+        return p == end;
+    }
+
+private:
+    static bool hasPosition(StrokeOpType type) {
+        return type != StrokeOpType::Clear && type != StrokeOpType::Cancel;
+    }
+
+    static uint64_t zigzag(int64_t v) {
+        return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    }
+
+    static int32_t unzigzag(uint64_t v) {
+        return static_cast<int32_t>((v >> 1) ^ (~(v & 1) + 1));
+    }
+
+    static void putVarint(std::vector<uint8_t>& out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<uint8_t>(v) | 0x80);
+            v >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(v));
+    }
+
+    static bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64 && p < end; shift += 7) {
+            uint8_t byte = *p++;
+            v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+};
+
+/**
+ * @class StrokeSyncPeer
+ * @brief Exchanges stroke batches with other instances
+ *
+ * Call record() from the mouse callback instead of drawing, then flush() and
+ * poll() once per frame before compositing. poll() returns the received
+ * batches together with the ones this instance flushed, sorted by (Lamport
+ * clock, instance id), so local strokes take the same ordered path as remote
+ * ones. Batches that reach peers in the same poll are applied in the same
+ * order everywhere; one delayed past a later poll is applied when it arrives.
+ * All sockets are non-blocking; nothing here ever stalls the render loop.
+ */
+class StrokeSyncPeer {
+public:
+    explicit StrokeSyncPeer(uint32_t instanceId = std::random_device{}())
+        : instanceId_(instanceId), listenFd_(-1), clock_(0),
+          bytesSent_(0), bytesReceived_(0) {}
+
+    ~StrokeSyncPeer() { close(); }
+
+    StrokeSyncPeer(const StrokeSyncPeer&) = delete;
+    StrokeSyncPeer& operator=(const StrokeSyncPeer&) = delete;
+
+    /**
+     * @brief Accept peers on an endpoint
+     * @param endpoint "unix:/path/to.sock" or "tcp:host:port"
+     * @return True if listening (see error() otherwise)
+     */
+    bool listen(const std::string& endpoint) {
+        int fd = openSocket(endpoint, true);
+        if (fd < 0) return false;
+        listenFd_ = fd;
+        return true;
+    }
+
+    /**
+     * @brief Connect to a listening peer
+     * @param endpoint "unix:/path/to.sock" or "tcp:host:port"
+     * @return True if connected (see error() otherwise)
+     */
+    bool connect(const std::string& endpoint) {
+        int fd = openSocket(endpoint, false);
+        return fd >= 0 && attach(fd);
+    }
+
+    /**
+     * @brief Adopt an already connected socket
+     * @param fd Connected stream socket (ownership is taken)
+     * @return True on success
+     */
+    bool attach(int fd) {
+#ifdef _WIN32
+        (void)fd;
+        return fail("stroke sync is not supported on Windows");
+#else
+        if (fd < 0 || !setNonBlocking(fd)) {
+            if (fd >= 0) ::close(fd);
+            return fail("cannot attach socket");
+        }
+        connections_.push_back(Connection{fd, {}, {}});
+        return true;
+#endif
+    }
+
+    /**
+     * @brief Connect two peers in this process through a socket pair
+     * @return True if both ends were attached
+     */
+    static bool connectLoopback(StrokeSyncPeer& a, StrokeSyncPeer& b) {
+#ifdef _WIN32
+        a.fail("stroke sync is not supported on Windows");
+        b.fail("stroke sync is not supported on Windows");
+        return false;
+#else
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            return a.fail("cannot create socket pair");
+        }
+        return a.attach(fds[0]) && b.attach(fds[1]);
+#endif
+    }
+
+    /**
+     * @brief Queue an operation for the current frame's batch
+     */
+    void record(const StrokeOp& op) { pending_.ops.push_back(op); }
+
+    /**
+     * @brief Operations recorded since the last flush()
+     */
+    size_t queued() const { return pending_.ops.size(); }
+
+    /**
+     * @brief Stamp and send the current frame's batch and start the next frame
+     *
+     * The batch is also kept for the next poll(), which returns it in order
+     * with the batches of other instances.
+     * @return False if nothing is connected
+     */
+    bool flush() {
+        acceptPending();
+        if (pending_.ops.empty()) {
+            return !connections_.empty();
+        }
+        pending_.instanceId = instanceId_;
+        pending_.clock = ++clock_;
+        packet_.clear();
+        StrokeCodec::encode(pending_, packet_);
+        flushed_.push_back(std::move(pending_));
+        pending_ = StrokeBatch();
+
+        for (auto& conn : connections_) {
+            send(conn, packet_.data(), packet_.size());
+        }
+        dropClosed();
+        return !connections_.empty();
+    }
+
+    /**
+     * @brief Receive batches from all peers
+     *
+     * Each received clock moves this instance's clock past it.
+     * @param batches Output, replaced with the received and flushed batches in
+     *        (clock, instance id) order
+     * @return Number of batches returned
+     */
+    size_t poll(std::vector<StrokeBatch>& batches) {
+        acceptPending();
+        batches.clear();
+
+        for (size_t i = 0; i < connections_.size(); i++) {
+            Connection& conn = connections_[i];
+            if (conn.fd < 0) continue;
+            if (!conn.outbox.empty()) {
+                send(conn, nullptr, 0);
+            }
+            receive(conn);
+
+            size_t offset = 0;
+            while (conn.fd >= 0) {
+                const uint8_t* data = conn.inbox.data() + offset;
+                size_t size = StrokeCodec::packetSize(data, conn.inbox.size() - offset);
+                if (size == 0) break;
+                StrokeBatch batch;
+                if (size == SIZE_MAX || !StrokeCodec::decode(data, size, batch)) {
+                    closeConnection(conn);
+                    break;
+                }
+                // Relay to everyone else so a listener can host several peers
+                for (size_t j = 0; j < connections_.size(); j++) {
+                    if (j != i && connections_[j].fd >= 0) {
+                        send(connections_[j], data, size);
+                    }
+                }
+                clock_ = std::max(clock_, batch.clock) + 1;
+                batches.push_back(std::move(batch));
+                offset += size;
+            }
+            if (conn.fd >= 0) {
+                conn.inbox.erase(conn.inbox.begin(), conn.inbox.begin() + offset);
+            }
+        }
+        dropClosed();
+
+        for (auto& batch : flushed_) {
+            batches.push_back(std::move(batch));
+        }
+        flushed_.clear();
+        std::stable_sort(batches.begin(), batches.end(),
+                         [](const StrokeBatch& a, const StrokeBatch& b) {
+                             if (a.clock != b.clock) return a.clock < b.clock;
+                             return a.instanceId < b.instanceId;
+                         });
+        return batches.size();
+    }
+
+    /**
+     * @brief Close the listening socket and all peer connections
+     */
+    void close() {
+        for (auto& conn : connections_) {
+            closeConnection(conn);
+        }
+        connections_.clear();
+#ifndef _WIN32
+        if (listenFd_ >= 0) {
+            ::close(listenFd_);
+        }
+        if (!unixPath_.empty()) {
+            unlink(unixPath_.c_str());
+        }
+#endif
+        listenFd_ = -1;
+        unixPath_.clear();
+    }
+
+    bool isActive() const { return listenFd_ >= 0 || !connections_.empty(); }
+    size_t peerCount() const { return connections_.size(); }
+    uint32_t instanceId() const { return instanceId_; }
+    uint64_t clock() const { return clock_; }
+    uint64_t bytesSent() const { return bytesSent_; }
+    uint64_t bytesReceived() const { return bytesReceived_; }
+    const std::string& error() const { return error_; }
+
+private:
+    struct Connection {
+        int fd;
+        std::vector<uint8_t> inbox;
+        std::vector<uint8_t> outbox;
+    };
+
+    // A peer that cannot drain this much is considered dead
+    static constexpr size_t MAX_OUTBOX = 1u << 20;
+
+    bool fail(const std::string& message) {
+        error_ = message;
+        return false;
+    }
+
+    int openSocket(const std::string& endpoint, bool server) {
+#ifdef _WIN32
+        (void)endpoint;
+        (void)server;
+        fail("stroke sync is not supported on Windows");
+        return -1;
+#else
+        int fd = -1;
+        if (endpoint.compare(0, 5, "unix:") == 0) {
+            fd = openUnixSocket(endpoint.substr(5), server);
+        } else if (endpoint.compare(0, 4, "tcp:") == 0) {
+            std::string hostPort = endpoint.substr(4);
+            size_t colon = hostPort.rfind(':');
+            if (colon != std::string::npos) {
+                fd = openTcpSocket(hostPort.substr(0, colon), hostPort.substr(colon + 1),
+                                   server);
+            }
+        }
+        if (fd < 0) {
+            fail(std::string(server ? "cannot listen on " : "cannot connect to ") + endpoint);
+        }
+        return fd;
+#endif
+    }
+
+#ifndef _WIN32
+    int openUnixSocket(const std::string& path, bool server) {
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) return -1;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        const sockaddr* sa = reinterpret_cast<const sockaddr*>(&addr);
+        if (server) {
+            unlink(path.c_str());
+            if (bind(fd, sa, sizeof(addr)) != 0 || ::listen(fd, 8) != 0 ||
+                !setNonBlocking(fd)) {
+                ::close(fd);
+                return -1;
+            }
+            unixPath_ = path;
+        } else if (::connect(fd, sa, sizeof(addr)) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    int openTcpSocket(const std::string& host, const std::string& port, bool server) {
+        addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = server ? AI_PASSIVE : 0;
+        addrinfo* result = nullptr;
+        if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints,
+                        &result) != 0) {
+            return -1;
+        }
+
+        int fd = -1;
+        for (addrinfo* ai = result; ai && fd < 0; ai = ai->ai_next) {
+            fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) continue;
+            int one = 1;
+            bool ok;
+            if (server) {
+                setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+                ok = bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(fd, 8) == 0 &&
+                     setNonBlocking(fd);
+            } else {
+                ok = ::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0;
+                // Batches are tiny and latency-critical
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+            if (!ok) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(result);
+        return fd;
+    }
+
+    static bool setNonBlocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) return false;
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        return true;
+    }
+
+    void acceptPending() {
+        if (listenFd_ < 0) return;
+        while (true) {
+            int fd = accept(listenFd_, nullptr, nullptr);
+            if (fd < 0) break;
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            attach(fd);
+        }
+    }
+
+    void send(Connection& conn, const uint8_t* data, size_t size) {
+        if (conn.fd < 0) return;
+        if (size > 0) {
+            conn.outbox.insert(conn.outbox.end(), data, data + size);
+        }
+#ifdef MSG_NOSIGNAL
+        const int flags = MSG_NOSIGNAL;
+#else
+        const int flags = 0;
+#endif
+        size_t sent = 0;
+        while (sent < conn.outbox.size()) {
+            ssize_t n = ::send(conn.fd, conn.outbox.data() + sent, conn.outbox.size() - sent,
+                               flags);
+            if (n > 0) {
+                sent += static_cast<size_t>(n);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else {
+                closeConnection(conn);
+                return;
+            }
+        }
+        bytesSent_ += sent;
+        conn.outbox.erase(conn.outbox.begin(), conn.outbox.begin() + sent);
+        if (conn.outbox.size() > MAX_OUTBOX) {
+            closeConnection(conn);
+        }
+    }
+
+    void receive(Connection& conn) {
+        uint8_t buffer[4096];
+        while (conn.fd >= 0) {
+            ssize_t n = recv(conn.fd, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                conn.inbox.insert(conn.inbox.end(), buffer, buffer + n);
+                bytesReceived_ += static_cast<uint64_t>(n);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else {
+                closeConnection(conn);
+            }
+        }
+    }
+#else
+    // Nothing can be connected, so there is never anything to move
+    void acceptPending() {}
+    void send(Connection& /*conn*/, const uint8_t* /*data*/, size_t /*size*/) {}
+    void receive(Connection& /*conn*/) {}
+#endif  // _WIN32
+
+    static void closeConnection(Connection& conn) {
+        if (conn.fd >= 0) {
+#ifndef _WIN32
+            ::close(conn.fd);
+#endif
+            conn.fd = -1;
+        }
+    }
+
+    void dropClosed() {
+        connections_.erase(std::remove_if(connections_.begin(), connections_.end(),
+                                          [](const Connection& c) { return c.fd < 0; }),
+                           connections_.end());
+    }
+
+    uint32_t instanceId_;
+    int listenFd_;
+    std::string unixPath_;
+    std::string error_;
+    uint64_t clock_;
+    uint64_t bytesSent_;
+    uint64_t bytesReceived_;
+    StrokeBatch pending_;
+    std::vector<StrokeBatch> flushed_;
+    std::vector<uint8_t> packet_;
+    std::vector<Connection> connections_;
+};
+
+}  // namespace collab
+
+#endif  // STROKE_SYNC_H
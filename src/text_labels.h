@@ -0,0 +1,180 @@
+/**
+ * @file text_labels.h
+ * @brief Editable text labels drawn over the canvas
+ * @author Chethana G
+ * @date 2026-10-19
+ */
+
+#ifndef TEXT_LABELS_H
+#define TEXT_LABELS_H
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "glyph_atlas.h"
+
+namespace doodle {
+
+/**
+ * @struct TextLabel
+ * @brief One line of text anchored at its baseline
+ */
+struct TextLabel {
+    std::string text;
+    cv::Point origin;
+    cv::Scalar color;
+    double scale = 1.0;
+    int thickness = 1;
+};
+
+/**
+ * @class TextLabels
+ * @brief Labels that stay editable after they are placed
+ *
+ * Labels are kept as text rather than painted into the canvas, and are drawn
+ * through the glyph atlas every frame. At most one label is being edited at
+ * a time; while it is, keyboard input goes to it.
+ *
+ * Origins are in canvas coordinates, like strokes. When the canvas is
+ * anchored to the scene, draw() is given the same canvas-to-frame transform
+ * as the compositor, so labels move with the drawing; the text itself is
+ * not warped.
+ */
+class TextLabels {
+public:
+    static constexpr int FONT_FACE = cv::FONT_HERSHEY_SIMPLEX;
+
+    explicit TextLabels(GlyphAtlas& atlas) : atlas_(atlas), editing_(-1) {}
+
+    /**
+     * @brief Label under a point
+     * @return Index, or -1 if no label contains the point
+     */
+    int hitTest(cv::Point p) {
+        for (int i = static_cast<int>(labels_.size()) - 1; i >= 0; i--) {
+            if (bounds(i).contains(p)) return i;
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Start editing the label under a point, or a new label there
+     * @return Index of the label being edited
+     */
+    int edit(cv::Point p, const cv::Scalar& color, double scale, int thickness) {
+        finishEditing();
+        int hit = hitTest(p);
+        if (hit >= 0) {
+            editing_ = hit;
+        } else {
+            labels_.push_back(TextLabel{std::string(), p, color, scale, thickness});
+            editing_ = static_cast<int>(labels_.size()) - 1;
+        }
+        return editing_;
+    }
+
+    /**
+     * @brief Move the label being edited
+     */
+    void moveTo(cv::Point origin) {
+        if (editing()) labels_[editing_].origin = origin;
+    }
+
+    /**
+     * @brief Stop editing; a label left empty is removed
+     */
+    void finishEditing() {
+        if (editing() && labels_[editing_].text.empty()) {
+            labels_.erase(labels_.begin() + editing_);
+        }
+        editing_ = -1;
+    }
+
+    bool editing() const { return editing_ >= 0; }
+
+    /**
+     * @brief Feed a key from cv::waitKey to the label being edited
+     *
+     * Printable characters are appended, Backspace deletes, Enter and ESC
+     * finish editing.
+     * @return True if the key was consumed
+     */
+    bool handleKey(int key) {
+        if (!editing() || key < 0) return false;
+        std::string& text = labels_[editing_].text;
+        if (key == 8 || key == 127) {
+            if (!text.empty()) text.pop_back();
+        } else if (key == 13 || key == 10 || key == 27) {
+            finishEditing();
+        } else if (key >= 32 && key < 127) {
+            text.push_back(static_cast<char>(key));
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Bounding box of a label in canvas coordinates
+     */
+    cv::Rect bounds(int index) {
+        const TextLabel& label = labels_[index];
+        int descent = 0;
+        int ascent = atlas_.ascent(FONT_FACE, label.scale, label.thickness, &descent);
+        int width = atlas_.textWidth(label.text, FONT_FACE, label.scale, label.thickness);
+        return cv::Rect(label.origin.x, label.origin.y - ascent, std::max(width, ascent / 2),
+                        ascent + descent);
+    }
+
+    /**
+     * @brief Draw every label, with a caret on the one being edited
+     * @param img Target image
+     * @param transform Canvas-to-image homography (the compositor's anchor transform)
+     */
+    void draw(cv::Mat& img, const cv::Matx33d& transform = cv::Matx33d::eye()) {
+        for (int i = 0; i < static_cast<int>(labels_.size()); i++) {
+            const TextLabel& label = labels_[i];
+            const cv::Matx33d& h = transform;
+            double w = h(2, 0) * label.origin.x + h(2, 1) * label.origin.y + h(2, 2);
+            if (std::abs(w) < 1e-9) continue;
+            cv::Point origin(
+                cvRound((h(0, 0) * label.origin.x + h(0, 1) * label.origin.y + h(0, 2)) / w),
+                cvRound((h(1, 0) * label.origin.x + h(1, 1) * label.origin.y + h(1, 2)) / w));
+            atlas_.drawText(img, label.text, origin, FONT_FACE, label.scale, label.color,
+                            label.thickness);
+            if (i == editing_) {
+                cv::Rect box = bounds(i) + (origin - label.origin);
+                cv::rectangle(img, box, cv::Scalar(255, 255, 0), 1);
+                cv::Point caret(box.x + atlas_.textWidth(label.text, FONT_FACE, label.scale,
+                                                         label.thickness) + 1, box.y);
+                cv::line(img, caret, caret + cv::Point(0, box.height), label.color, 1);
+            }
+        }
+    }
+
+    const std::vector<TextLabel>& labels() const { return labels_; }
+
+    /**
+     * @brief Replace all labels, e.g. with the ones from a saved project
+     */
+    void assign(const std::vector<TextLabel>& labels) {
+        labels_ = labels;
+        editing_ = -1;
+    }
+
+    void clear() {
+        labels_.clear();
+        editing_ = -1;
+    }
+
+private:
+    GlyphAtlas& atlas_;
+    std::vector<TextLabel> labels_;
+    int editing_;
+};
+
+}  // namespace doodle
+
+#endif  // TEXT_LABELS_H
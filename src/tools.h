@@ -0,0 +1,526 @@
+/**
+ * @file tools.h
+ * @brief Drawing tool interface, the built-in tools and the tool registry
+ * @author Chethana G
+ * @date 2026-10-19
+ *
+ * Every tool reports the canvas rectangle it touched from each step of a
+ * stroke. The host feeds these damage rectangles to the dirty-region tracker,
+ * the compositor and the history, so none of them has to look at the whole
+ * canvas. New tools are added to a ToolRegistry; the main loop only talks to
+ * the Tool interface.
+ *
+ * Tools rasterize through ToolContext::paint rather than drawing on the
+ * canvas directly, so the same tool works on a BGR canvas and on a
+ * palette-indexed one.
+ */
+
+#ifndef TOOLS_H
+#define TOOLS_H
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "canvas_palette.h"
+#include "text_labels.h"
+
+namespace doodle {
+
+/**
+ * @struct ToolContext
+ * @brief Canvas and brush settings a stroke is drawn with
+ */
+struct ToolContext {
+    cv::Mat* canvas = nullptr;
+    cv::Scalar color = cv::Scalar(0, 0, 255);
+    cv::Scalar background = cv::Scalar(0, 0, 0);
+    int size = 3;
+    int lineType = cv::LINE_AA;
+    uint32_t seed = 0;  ///< Seed for stochastic tools, shared with remote peers
+    TextLabels* labels = nullptr;  ///< Label layer for the text tool, if any
+    CanvasPalette* palette = nullptr;  ///< Set when the canvas is palette-indexed
+
+    /**
+     * @brief Rasterize a shape onto the canvas
+     *
+     * A BGR canvas is drawn on directly. For an indexed canvas the shape is
+     * drawn as coverage into scratch the size of the bounds and merged into
+     * the index plane, which keeps anti-aliased edges.
+     * @param bounds Canvas region the shape may touch
+     * @param ink Color to paint
+     * @param draw Callable (cv::Mat& target, const cv::Scalar& ink, cv::Point offset)
+     *             that draws the shape with its points moved by -offset
+     */
+    template <typename Draw>
+    void paint(const cv::Rect& bounds, const cv::Scalar& ink, Draw draw) {
+        if (!palette) {
+            draw(*canvas, ink, cv::Point());
+            return;
+        }
+        cv::Rect region = bounds & cv::Rect(0, 0, canvas->cols, canvas->rows);
+        if (region.empty()) return;
+        cv::Mat coverage = palette->scratch(region.size());
+        draw(coverage, cv::Scalar::all(255), region.tl());
+        CanvasPalette::merge((*canvas)(region), coverage, palette->slot(ink));
+    }
+
+    /**
+     * @brief Pixel value that stands for a color on this canvas
+     */
+    cv::Scalar pixel(const cv::Scalar& ink) {
+        return palette ? cv::Scalar::all(palette->index(ink)) : ink;
+    }
+};
+
+/**
+ * @brief Bounding box of a segment grown by a margin, clipped to the canvas
+ * @param a First point
+ * @param b Second point
+ * @param margin Pixels to grow by on every side
+ * @param canvas Canvas to clip to
+ * @return Damage rectangle (empty if fully outside)
+ */
+inline cv::Rect segmentBounds(cv::Point a, cv::Point b, int margin, const cv::Mat& canvas) {
+    cv::Rect r(cv::Point(std::min(a.x, b.x) - margin, std::min(a.y, b.y) - margin),
+               cv::Point(std::max(a.x, b.x) + margin + 1, std::max(a.y, b.y) + margin + 1));
+    return r & cv::Rect(0, 0, canvas.cols, canvas.rows);
+}
+
+/**
+ * @brief Union of two rectangles that treats empty rectangles as neutral
+ */
+inline cv::Rect unite(const cv::Rect& a, const cv::Rect& b) {
+    if (a.empty()) return b;
+    if (b.empty()) return a;
+    return a | b;
+}
+
+/**
+ * @class Tool
+ * @brief A drawing tool driven through one stroke at a time
+ *
+ * Every step returns the rectangle of canvas pixels it changed. A stroke is
+ * begin(), any number of update() calls, then commit() or cancel(). After
+ * cancel() the host restores the pixels the stroke touched.
+ */
+class Tool {
+public:
+    virtual ~Tool() = default;
+
+    virtual const char* name() const = 0;
+
+    /**
+     * @brief Start a stroke (mouse down)
+     * @return Damage rectangle
+     */
+    virtual cv::Rect begin(ToolContext& ctx, cv::Point p) = 0;
+
+    /**
+     * @brief Continue a stroke (mouse move while drawing)
+     * @return Damage rectangle
+     */
+    virtual cv::Rect update(ToolContext& ctx, cv::Point p) = 0;
+
+    /**
+     * @brief Finish a stroke (mouse up)
+     * @return Damage rectangle
+     */
+    virtual cv::Rect commit(ToolContext& ctx, cv::Point p) = 0;
+
+    /**
+     * @brief Abandon a stroke, dropping any per-stroke state
+     * @return Damage rectangle
+     */
+    virtual cv::Rect cancel(ToolContext& /*ctx*/) { return cv::Rect(); }
+};
+
+/**
+ * @class BrushTool
+ * @brief Freehand anti-aliased strokes
+ */
+class BrushTool : public Tool {
+public:
+    const char* name() const override { return "Brush"; }
+
+    cv::Rect begin(ToolContext& /*ctx*/, cv::Point p) override {
+        last_ = p;
+        return cv::Rect();
+    }
+
+    cv::Rect update(ToolContext& ctx, cv::Point p) override {
+        int width = thickness(ctx);
+        cv::Point from = last_;
+        cv::Rect damage = segmentBounds(from, p, width / 2 + 2, *ctx.canvas);
+        ctx.paint(damage, paint(ctx), [&](cv::Mat& img, const cv::Scalar& ink, cv::Point o) {
+            cv::line(img, from - o, p - o, ink, width, ctx.lineType);
+        });
+        last_ = p;
+        return damage;
+    }
+
+    cv::Rect commit(ToolContext& /*ctx*/, cv::Point /*p*/) override { return cv::Rect(); }
+
+protected:
+    virtual cv::Scalar paint(const ToolContext& ctx) const { return ctx.color; }
+    virtual int thickness(const ToolContext& ctx) const { return ctx.size; }
+
+private:
+    cv::Point last_;
+};
+
+/**
+ * @class EraserTool
+ * @brief Brush that paints the background color at double width
+ */
+class EraserTool : public BrushTool {
+public:
+    const char* name() const override { return "Eraser"; }
+
+protected:
+    cv::Scalar paint(const ToolContext& ctx) const override { return ctx.background; }
+    int thickness(const ToolContext& ctx) const override { return ctx.size * 2; }
+};
+
+/**
+ * @class SprayTool
+ * @brief Particle spray; the per-stroke seed makes it reproducible remotely
+ */
+class SprayTool : public Tool {
+public:
+    SprayTool() : distribution_(-10, 10) {}
+
+    const char* name() const override { return "Spray"; }
+
+    cv::Rect begin(ToolContext& ctx, cv::Point p) override {
+        rng_.seed(ctx.seed);
+        return spray(ctx, p);
+    }
+
+    cv::Rect update(ToolContext& ctx, cv::Point p) override { return spray(ctx, p); }
+
+    cv::Rect commit(ToolContext& /*ctx*/, cv::Point /*p*/) override { return cv::Rect(); }
+
+private:
+    cv::Rect spray(ToolContext& ctx, cv::Point center) {
+        const cv::Mat& canvas = *ctx.canvas;
+        int radius = ctx.size * 2;
+        int numParticles = radius * 2;
+        cv::Rect damage = segmentBounds(center, center, radius + 2, canvas);
+        ctx.paint(damage, ctx.color, [&](cv::Mat& img, const cv::Scalar& ink, cv::Point o) {
+            for (int i = 0; i < numParticles; i++) {
+                int offsetX = distribution_(rng_) * radius / 10;
+                int offsetY = distribution_(rng_) * radius / 10;
+                cv::Point particle(center.x + offsetX, center.y + offsetY);
+                if (particle.x >= 0 && particle.x < canvas.cols && particle.y >= 0 &&
+                    particle.y < canvas.rows) {
+                    cv::circle(img, particle - o, 1, ink, -1);
+                }
+            }
+        });
+        return damage;
+    }
+
+    std::default_random_engine rng_;
+    std::uniform_int_distribution<int> distribution_;
+};
+
+/**
+ * @class FillTool
+ * @brief Flood fill of the region under the cursor
+ */
+class FillTool : public Tool {
+public:
+    const char* name() const override { return "Fill"; }
+
+    cv::Rect begin(ToolContext& ctx, cv::Point seed) override {
+        cv::Mat& img = *ctx.canvas;
+        if (seed.x < 0 || seed.x >= img.cols || seed.y < 0 || seed.y >= img.rows) {
+            return cv::Rect();
+        }
+        // Indexed pixels only match their exact index
+        cv::Scalar tolerance = ctx.palette ? cv::Scalar::all(0) : cv::Scalar(10, 10, 10);
+        cv::Rect filled;
+        cv::floodFill(img, seed, ctx.pixel(ctx.color), &filled, tolerance, tolerance,
+                      cv::FLOODFILL_FIXED_RANGE);
+        return filled;
+    }
+
+    cv::Rect update(ToolContext& /*ctx*/, cv::Point /*p*/) override { return cv::Rect(); }
+    cv::Rect commit(ToolContext& /*ctx*/, cv::Point /*p*/) override { return cv::Rect(); }
+};
+
+/**
+ * @class TextTool
+ * @brief Places a text label, or picks an existing one for editing
+ *
+ * Clicking starts editing the label under the cursor or a new one; dragging
+ * moves it. The text itself comes from the keyboard through TextLabels, and
+ * labels are not painted into the canvas, so every step returns no damage.
+ */
+class TextTool : public Tool {
+public:
+    const char* name() const override { return "Text"; }
+
+    cv::Rect begin(ToolContext& ctx, cv::Point p) override {
+        if (!ctx.labels) return cv::Rect();
+        int index = ctx.labels->edit(p, ctx.color, 0.5 + 0.1 * ctx.size, 1 + ctx.size / 8);
+        grab_ = ctx.labels->labels()[index].origin - p;
+        return cv::Rect();
+    }
+
+    cv::Rect update(ToolContext& ctx, cv::Point p) override {
+        if (ctx.labels) ctx.labels->moveTo(p + grab_);
+        return cv::Rect();
+    }
+
+    cv::Rect commit(ToolContext& /*ctx*/, cv::Point /*p*/) override { return cv::Rect(); }
+
+private:
+    cv::Point grab_;
+};
+
+/**
+ * @class ShapeTool
+ * @brief Base for shapes dragged out from a start point with live preview
+ *
+ * Instead of cloning the whole canvas for every preview, the tool saves only
+ * the pixels under the current preview and puts them back before drawing
+ * the next one.
+ */
+class ShapeTool : public Tool {
+public:
+    cv::Rect begin(ToolContext& ctx, cv::Point p) override {
+        start_ = p;
+        underRect_ = cv::Rect();
+        if (under_.size() != ctx.canvas->size() || under_.type() != ctx.canvas->type()) {
+            under_.create(ctx.canvas->size(), ctx.canvas->type());
+        }
+        return cv::Rect();
+    }
+
+    cv::Rect update(ToolContext& ctx, cv::Point p) override {
+        cv::Rect damage = restore(ctx);
+        underRect_ = shapeBounds(ctx, start_, p) & cv::Rect(0, 0, ctx.canvas->cols,
+                                                             ctx.canvas->rows);
+        if (!underRect_.empty()) {
+            (*ctx.canvas)(underRect_).copyTo(under_(underRect_));
+        }
+        drawShape(ctx, start_, p);
+        return unite(damage, underRect_);
+    }
+
+    cv::Rect commit(ToolContext& ctx, cv::Point p) override {
+        cv::Rect damage = update(ctx, p);
+        underRect_ = cv::Rect();
+        return damage;
+    }
+
+    cv::Rect cancel(ToolContext& ctx) override { return restore(ctx); }
+
+protected:
+    /**
+     * @brief Rectangle the shape between two points may cover
+     */
+    virtual cv::Rect shapeBounds(const ToolContext& ctx, cv::Point a, cv::Point b) const = 0;
+
+    /**
+     * @brief Rasterize the shape between two points
+     */
+    virtual void drawShape(ToolContext& ctx, cv::Point a, cv::Point b) = 0;
+
+    static cv::Rect pointBounds(cv::Point a, cv::Point b, int margin) {
+        return cv::Rect(cv::Point(std::min(a.x, b.x) - margin, std::min(a.y, b.y) - margin),
+                        cv::Point(std::max(a.x, b.x) + margin + 1,
+                                  std::max(a.y, b.y) + margin + 1));
+    }
+
+private:
+    cv::Rect restore(ToolContext& ctx) {
+        cv::Rect damage = underRect_;
+        if (!damage.empty()) {
+            under_(damage).copyTo((*ctx.canvas)(damage));
+        }
+        underRect_ = cv::Rect();
+        return damage;
+    }
+
+    cv::Point start_;
+    cv::Mat under_;
+    cv::Rect underRect_;
+};
+
+/**
+ * @class LineTool
+ * @brief Straight anti-aliased line
+ */
+class LineTool : public ShapeTool {
+public:
+    const char* name() const override { return "Line"; }
+
+protected:
+    cv::Rect shapeBounds(const ToolContext& ctx, cv::Point a, cv::Point b) const override {
+        return pointBounds(a, b, ctx.size / 2 + 2);
+    }
+
+    void drawShape(ToolContext& ctx, cv::Point a, cv::Point b) override {
+        ctx.paint(shapeBounds(ctx, a, b), ctx.color,
+                  [&](cv::Mat& img, const cv::Scalar& ink, cv::Point o) {
+                      cv::line(img, a - o, b - o, ink, ctx.size, ctx.lineType);
+                  });
+    }
+};
+
+/**
+ * @class RectangleTool
+ * @brief Axis-aligned rectangle outline
+ */
+class RectangleTool : public ShapeTool {
+public:
+    const char* name() const override { return "Rectangle"; }
+
+protected:
+    cv::Rect shapeBounds(const ToolContext& ctx, cv::Point a, cv::Point b) const override {
+        return pointBounds(a, b, ctx.size / 2 + 2);
+    }
+
+    void drawShape(ToolContext& ctx, cv::Point a, cv::Point b) override {
+        ctx.paint(shapeBounds(ctx, a, b), ctx.color,
+                  [&](cv::Mat& img, const cv::Scalar& ink, cv::Point o) {
+                      cv::rectangle(img, a - o, b - o, ink, ctx.size, ctx.lineType);
+                  });
+    }
+};
+
+/**
+ * @class CircleTool
+ * @brief Circle outline centered on the start point
+ */
+class CircleTool : public ShapeTool {
+public:
+    const char* name() const override { return "Circle"; }
+
+protected:
+    cv::Rect shapeBounds(const ToolContext& ctx, cv::Point a, cv::Point b) const override {
+        int r = radius(a, b) + ctx.size / 2 + 2;
+        return pointBounds(a - cv::Point(r, r), a + cv::Point(r, r), 0);
+    }
+
+    void drawShape(ToolContext& ctx, cv::Point a, cv::Point b) override {
+        ctx.paint(shapeBounds(ctx, a, b), ctx.color,
+                  [&](cv::Mat& img, const cv::Scalar& ink, cv::Point o) {
+                      cv::circle(img, a - o, radius(a, b), ink, ctx.size, ctx.lineType);
+                  });
+    }
+
+private:
+    static int radius(cv::Point a, cv::Point b) {
+        return static_cast<int>(std::sqrt(std::pow(b.x - a.x, 2) + std::pow(b.y - a.y, 2)));
+    }
+};
+
+/**
+ * @class EllipseTool
+ * @brief Ellipse inscribed in the dragged rectangle
+ */
+class EllipseTool : public ShapeTool {
+public:
+    const char* name() const override { return "Ellipse"; }
+
+protected:
+    cv::Rect shapeBounds(const ToolContext& ctx, cv::Point a, cv::Point b) const override {
+        return pointBounds(a, b, ctx.size / 2 + 2);
+    }
+
+    void drawShape(ToolContext& ctx, cv::Point a, cv::Point b) override {
+        cv::Point center((a.x + b.x) / 2, (a.y + b.y) / 2);
+        cv::Size axes(std::abs(b.x - a.x) / 2, std::abs(b.y - a.y) / 2);
+        ctx.paint(shapeBounds(ctx, a, b), ctx.color,
+                  [&](cv::Mat& img, const cv::Scalar& ink, cv::Point o) {
+                      cv::ellipse(img, center - o, axes, 0, 0, 360, ink, ctx.size,
+                                  ctx.lineType);
+                  });
+    }
+};
+
+/**
+ * @class ToolRegistry
+ * @brief Named tool factories selectable by keyboard shortcut
+ *
+ * Tool ids are registration indices and are what gets sent to remote peers,
+ * so every instance must register the same tools in the same order.
+ */
+class ToolRegistry {
+public:
+    using Factory = std::function<std::unique_ptr<Tool>()>;
+
+    /**
+     * @brief Register a tool
+     * @param name Display name
+     * @param key Keyboard shortcut
+     * @param factory Creates a fresh tool instance
+     * @return Tool id
+     */
+    int add(const std::string& name, int key, Factory factory) {
+        entries_.push_back(Entry{name, key, std::move(factory)});
+        return static_cast<int>(entries_.size()) - 1;
+    }
+
+    /**
+     * @brief Create an instance of a registered tool
+     * @return Null if the id is unknown
+     */
+    std::unique_ptr<Tool> create(int id) const {
+        return valid(id) ? entries_[id].factory() : nullptr;
+    }
+
+    /**
+     * @brief Find the tool bound to a key
+     * @return Tool id, or -1 if no tool uses that key
+     */
+    int findByKey(int key) const {
+        for (size_t i = 0; i < entries_.size(); i++) {
+            if (entries_[i].key == key) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    bool valid(int id) const { return id >= 0 && id < static_cast<int>(entries_.size()); }
+    size_t size() const { return entries_.size(); }
+    const std::string& name(int id) const { return entries_[id].name; }
+    int key(int id) const { return entries_[id].key; }
+
+    /**
+     * @brief Registry with the nine built-in tools on keys 1-9
+     */
+    static ToolRegistry withDefaultTools() {
+        ToolRegistry registry;
+        registry.add("Brush", '1', [] { return std::make_unique<BrushTool>(); });
+        registry.add("Eraser", '2', [] { return std::make_unique<EraserTool>(); });
+        registry.add("Line", '3', [] { return std::make_unique<LineTool>(); });
+        registry.add("Rectangle", '4', [] { return std::make_unique<RectangleTool>(); });
+        registry.add("Circle", '5', [] { return std::make_unique<CircleTool>(); });
+        registry.add("Ellipse", '6', [] { return std::make_unique<EllipseTool>(); });
+        registry.add("Spray", '7', [] { return std::make_unique<SprayTool>(); });
+        registry.add("Fill", '8', [] { return std::make_unique<FillTool>(); });
+        registry.add("Text", '9', [] { return std::make_unique<TextTool>(); });
+        return registry;
+    }
+
+private:
+    struct Entry {
+        std::string name;
+        int key;
+        Factory factory;
+    };
+
+    std::vector<Entry> entries_;
+};
+
+}  // namespace doodle
+
+#endif  // TOOLS_H
@@ -0,0 +1,153 @@
+/**
+ * @file shm_consumer.cpp
+ * @brief Reference reader for the shared-memory frame output
+ * @author Chethana G
+ * @date 2026-10-19
+ *
+ * Attaches to the ring published by `live_doodle --shm-output NAME`, follows
+ * the newest frame and reports throughput, dropped frames and the latency
+ * from publication to the moment the frame is in hand. Frames are read in
+ * place; --show displays them as a visual check.
+ */
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <opencv2/opencv.hpp>
+#include "../src/latency_tracker.h"
+#include "../src/shared_frame_ring.h"
+
+using namespace std;
+
+void printUsage(const char* program) {
+    cout << "Usage: " << program << " [options]" << endl;
+    cout << "  --name NAME        Shared-memory object (default: /livedoodle)" << endl;
+    cout << "  --frames N         Stop after N frames (default: 300)" << endl;
+    cout << "  --timeout-ms MS    Give up after MS without a frame (default: 2000)" << endl;
+    cout << "  --show             Display the frames" << endl;
+}
+
+// Whole-string numeric parsing; false on junk, overflow or an empty value
+bool parseCount(const char* text, uint64_t& value) {
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long parsed = strtoull(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || text[0] == '-') return false;
+    value = parsed;
+    return true;
+}
+
+bool parseMilliseconds(const char* text, double& value) {
+    char* end = nullptr;
+    errno = 0;
+    double parsed = strtod(text, &end);
+    if (end == text || *end != '\0' || errno == ERANGE || !std::isfinite(parsed) ||
+        parsed <= 0.0) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    string name = "/livedoodle";
+    uint64_t maxFrames = 300;
+    double timeoutMs = 2000.0;
+    bool show = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--name" && i + 1 < argc) {
+            name = argv[++i];
+        } else if (arg == "--frames" && i + 1 < argc) {
+            if (!parseCount(argv[++i], maxFrames)) {
+                cerr << "Error: Invalid frame count: " << argv[i] << endl;
+                printUsage(argv[0]);
+                return -1;
+            }
+        } else if (arg == "--timeout-ms" && i + 1 < argc) {
+            if (!parseMilliseconds(argv[++i], timeoutMs)) {
+                cerr << "Error: Invalid timeout: " << argv[i] << endl;
+                printUsage(argv[0]);
+                return -1;
+            }
+        } else if (arg == "--show") {
+            show = true;
+        } else {
+            printUsage(argv[0]);
+            return (arg == "--help" || arg == "-h") ? 0 : -1;
+        }
+    }
+
+    doodle::SharedFrameRing ring;
+    if (!ring.open(name)) {
+        cerr << "Error: " << ring.error() << endl;
+        return -1;
+    }
+    cv::Size size = ring.size();
+    cout << "Attached to " << name << ": " << size.width << "x" << size.height << ", "
+         << ring.slots() << " slots" << endl;
+
+    performance::LatencyHistogram latency;
+    uint64_t received = 0, dropped = 0, torn = 0, checksum = 0;
+    uint64_t lastSequence = ring.latestSequence();
+    int64_t startNs = 0, endNs = 0;
+    doodle::SharedFrameRing::Frame frame;
+
+    while (received < maxFrames) {
+        if (!ring.wait(lastSequence, timeoutMs)) {
+            cerr << "No frame for " << timeoutMs << " ms, stopping" << endl;
+            break;
+        }
+        uint64_t sequence = ring.latestSequence();
+        if (!ring.read(sequence, frame)) {
+            torn++;
+            continue;
+        }
+        int64_t inHandNs = doodle::SharedFrameRing::now();
+
+        // Touch the frame in place; a real consumer would convert or encode it here
+        checksum += frame.image.ptr(frame.image.rows / 2)[0];
+        if (show) {
+            cv::imshow("shm_consumer", frame.image);
+            cv::waitKey(1);
+        }
+        if (!ring.valid(frame)) {
+            torn++;
+            continue;
+        }
+
+        if (received == 0) {
+            startNs = frame.timestampNs;
+        } else if (lastSequence != 0 && sequence > lastSequence + 1) {
+            dropped += sequence - lastSequence - 1;
+        }
+        endNs = frame.timestampNs;
+        latency.add((inHandNs - frame.timestampNs) / 1e6);
+        lastSequence = sequence;
+        received++;
+    }
+
+    double seconds = (endNs - startNs) / 1e9;
+    double frameMB = size.area() * CV_ELEM_SIZE(ring.type()) / (1024.0 * 1024.0);
+    char line[160];
+    cout << endl;
+    snprintf(line, sizeof(line), "Frames: %llu received, %llu skipped, %llu overwritten while read",
+             static_cast<unsigned long long>(received), static_cast<unsigned long long>(dropped),
+             static_cast<unsigned long long>(torn));
+    cout << line << endl;
+    if (seconds > 0 && received > 1) {
+        snprintf(line, sizeof(line), "Throughput: %.1f fps, %.1f MB/s", (received - 1) / seconds,
+                 (received - 1) * frameMB / seconds);
+        cout << line << endl;
+    }
+    snprintf(line, sizeof(line), "Latency ms: p50 %.3f  p95 %.3f  p99 %.3f  max %.3f",
+             latency.percentile(50), latency.percentile(95), latency.percentile(99),
+             latency.max());
+    cout << line << endl;
+    cout << "Checksum: " << checksum << endl;
+    return 0;
+}